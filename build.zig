@@ -173,6 +173,9 @@ pub fn build(b: *std.Build) void {
     exe.root_module.addIncludePath(b.path("src"));
     exe.root_module.addCSourceFile(.{ .file = b.path("src/occ.cxx"), .flags = &.{"-fno-sanitize=undefined"} });
     exe.root_module.addCSourceFile(.{ .file = b.path("src/svg.cxx"), .flags = &.{"-fno-sanitize=undefined"} });
+    exe.root_module.addCSourceFile(.{ .file = b.path("src/clash.cxx"), .flags = &.{"-fno-sanitize=undefined"} });
+    exe.root_module.addCSourceFile(.{ .file = b.path("src/properties.cxx"), .flags = &.{"-fno-sanitize=undefined"} });
+    exe.root_module.addCSourceFile(.{ .file = b.path("src/primitives.cxx"), .flags = &.{"-fno-sanitize=undefined"} });
 
     if (buildOCCTLibs) {
         addOCCTLibs(&occt_libs, exe);
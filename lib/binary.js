@@ -0,0 +1,255 @@
+// @ts-check
+
+// binary encoding of recipes read by src/recipe.zig
+
+export const recipeContentType = "application/x-cade-recipe";
+
+const version = 1;
+
+const operations = [
+  "extrusion",
+  "sweep",
+  "revolve",
+  "locate",
+  "fuse",
+  "intersect",
+  "cut",
+  "box",
+  "cylinder",
+  "countersink",
+  "linear_pattern",
+  "circular_pattern",
+];
+
+const encoder = new TextEncoder();
+
+class RecipeWriter {
+  constructor() {
+    this.bytes = new Uint8Array(1024);
+    this.view = new DataView(this.bytes.buffer);
+    this.offset = 0;
+  }
+
+  reserve(size) {
+    if (this.offset + size <= this.bytes.length) return;
+    let length = this.bytes.length * 2;
+    while (this.offset + size > length) length *= 2;
+    const bytes = new Uint8Array(length);
+    bytes.set(this.bytes);
+    this.bytes = bytes;
+    this.view = new DataView(bytes.buffer);
+  }
+
+  u8(value) {
+    this.reserve(1);
+    this.view.setUint8(this.offset, value);
+    this.offset += 1;
+  }
+
+  u32(value) {
+    this.reserve(4);
+    this.view.setUint32(this.offset, value, true);
+    this.offset += 4;
+  }
+
+  f64(value) {
+    this.reserve(8);
+    this.view.setFloat64(this.offset, value, true);
+    this.offset += 8;
+  }
+
+  magic(value) {
+    for (let i = 0; i < 4; i++) this.u8(value.charCodeAt(i));
+    this.u8(version);
+  }
+
+  /**
+   * @param {{toString(): string} | string} value
+   */
+  string(value) {
+    const bytes = encoder.encode(value.toString());
+    this.u32(bytes.length);
+    this.reserve(bytes.length);
+    this.bytes.set(bytes, this.offset);
+    this.offset += bytes.length;
+  }
+
+  paths(paths) {
+    this.u32(paths.length);
+    for (const path of paths) this.string(path);
+  }
+
+  /**
+   * @param {DOMMatrix | number[]} m
+   */
+  matrix(m) {
+    const values = Array.isArray(m)
+      ? m
+      : [
+        m.m11, m.m12, m.m13, m.m14,
+        m.m21, m.m22, m.m23, m.m24,
+        m.m31, m.m32, m.m33, m.m34,
+        m.m41, m.m42, m.m43, m.m44,
+      ];
+    for (const value of values) this.f64(value);
+  }
+
+  vector(v) {
+    for (let i = 0; i < 3; i++) this.f64(v[i]);
+  }
+
+  optionalMatrix(m) {
+    this.u8(m ? 1 : 0);
+    if (m) this.matrix(m);
+  }
+
+  operands(operands) {
+    this.u32(operands.length);
+    for (const { shape, placement } of operands) {
+      this.u32(shape);
+      this.optionalMatrix(placement);
+    }
+  }
+
+  recipe({ shape }) {
+    this.magic("CADR");
+    this.u32(shape.length);
+    for (const step of shape) {
+      const operation = operations.indexOf(step.type);
+      if (operation === -1)
+        throw new Error(`cannot encode operation ${step.type}`);
+
+      this.u8(operation);
+      this.optionalMatrix(step.placement);
+
+      switch (step.type) {
+        case "extrusion":
+          this.f64(step.length);
+          this.paths(step.outsides);
+          this.paths(step.insides);
+          break;
+        case "sweep":
+          this.string(step.directrix);
+          this.paths(step.outsides);
+          this.paths(step.insides);
+          break;
+        case "revolve":
+          this.string(step.path);
+          this.matrix(step.axis);
+          this.f64(step.rotation);
+          break;
+        case "locate":
+          this.u32(step.shape);
+          break;
+        case "fuse":
+        case "intersect":
+          this.operands(step.shapes);
+          break;
+        case "cut":
+          this.u32(step.shape);
+          this.operands(step.cutouts);
+          break;
+        case "box":
+          this.vector(step.size);
+          break;
+        case "cylinder":
+          this.f64(step.radius);
+          this.f64(step.length);
+          break;
+        case "countersink":
+          this.f64(step.radius);
+          this.f64(step.length);
+          this.f64(step.head_radius);
+          this.f64(step.rotation);
+          break;
+        case "linear_pattern":
+          this.u32(step.shape);
+          this.u32(step.count);
+          this.vector(step.offset);
+          break;
+        case "circular_pattern":
+          this.u32(step.shape);
+          this.u32(step.count);
+          this.matrix(step.axis);
+          this.f64(step.rotation);
+          break;
+      }
+    }
+  }
+
+  result() {
+    return this.bytes.slice(0, this.offset);
+  }
+}
+
+/**
+ * Encodes the output of `Part.toJson`
+ * @param {{shape: any[]}} recipe
+ * @returns {Uint8Array}
+ */
+export function encodeRecipe(recipe) {
+  const writer = new RecipeWriter();
+  writer.recipe(recipe);
+  return writer.result();
+}
+
+/**
+ * @param {{part: {shape: any[]}, plane?: DOMMatrix}[]} geometries
+ * @returns {Uint8Array}
+ */
+export function encodeSections(geometries) {
+  const writer = new RecipeWriter();
+  writer.magic("CADS");
+  writer.u32(geometries.length);
+  for (const { part, plane } of geometries) {
+    writer.recipe(part);
+    writer.optionalMatrix(plane);
+  }
+  return writer.result();
+}
+
+/**
+ * @param {{part: {shape: any[]}, etag: string | null}[]} parts
+ * @returns {Uint8Array}
+ */
+export function encodeMeshBatch(parts) {
+  const writer = new RecipeWriter();
+  writer.magic("CADM");
+  writer.u32(parts.length);
+  for (const { part, etag } of parts) {
+    writer.recipe(part);
+    writer.string(etag ?? "");
+  }
+  return writer.result();
+}
+
+/**
+ * @param {{part: {shape: any[]}, density: number}[]} parts
+ * @returns {Uint8Array}
+ */
+export function encodeQuery(parts) {
+  const writer = new RecipeWriter();
+  writer.magic("CADQ");
+  writer.u32(parts.length);
+  for (const { part, density } of parts) {
+    writer.recipe(part);
+    writer.f64(density);
+  }
+  return writer.result();
+}
+
+/**
+ * @param {{part: {shape: any[]}, instances: DOMMatrix[]}[]} geometries
+ * @returns {Uint8Array}
+ */
+export function encodeDefinition(geometries) {
+  const writer = new RecipeWriter();
+  writer.magic("CADD");
+  writer.u32(geometries.length);
+  for (const { part, instances } of geometries) {
+    writer.recipe(part);
+    writer.u32(instances.length);
+    for (const instance of instances) writer.matrix(instance);
+  }
+  return writer.result();
+}
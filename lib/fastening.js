@@ -15,7 +15,7 @@ import { keyToComparison } from "../tools/utils.js";
 import { nx3, nz3, y3, z3, zero3 } from "./defaults.js";
 import { FlatPart } from "./flat.js";
 import { Assembly, BasePart } from "./lib.js";
-import { cut, extrusion } from "./operations.js";
+import { cut, cylinder } from "./operations.js";
 import { Part } from "./part.js";
 import { locateOriginsOnFlatPart } from "./utils.js";
 
@@ -63,10 +63,10 @@ export function fastenSubpartToPart(
 
       const holeOnPart = holeToSubToPart.translate(...location);
 
-      const drill = extrusion(
+      const drill = cylinder(
         holeOnPart.translate(0, 0, -1 * thickness),
+        diameter / 2,
         thickness * 3,
-        Path.makeCircle(diameter / 2),
       );
 
       drills.push(drill);
@@ -6,7 +6,8 @@ import { dot, eps, plus } from "../tools/2d.js";
 import { collinear3, cross, dot3, minus3, mult3, norm3, normalize3, plus3, project3 } from "../tools/3d.js";
 import { a2m, atm3, computeAngleBetweenVectors, intersectPlanes, transformPoint3 } from "../tools/transform.js";
 import { x3, y3, z3, zero3 } from "./defaults.js";
-import { matrixAwareReplacer } from "./json.js";
+import { encodeDefinition, encodeSections, recipeContentType } from "./binary.js";
+import { fetchMeshes } from "./mesh.js";
 import { defaultMaterial } from "./materials.js";
 
 /** @typedef {{child: BasePart, placement: DOMMatrix}} LocatedPart */
@@ -111,10 +112,19 @@ export class Assembly extends BasePart {
       uniqueNames.add(item.name);
     }
 
+    // parts go to the server in a single request, anything else meshes itself
+    const parts = [];
     const result = [];
     for (const { item } of Object.values(flat)) {
-      result.push(item.loadMesh());
+      if (typeof item.toJson === "function") parts.push(item);
+      else result.push(item.loadMesh());
     }
+    if (parts.length)
+      result.push(
+        fetchMeshes(parts).then((meshes) =>
+          meshes.forEach((mesh, i) => (parts[i].mesh = mesh)),
+        ),
+      );
     await Promise.all(result);
   }
 
@@ -379,11 +389,60 @@ export class Assembly extends BasePart {
     if (file)
       params.append("file", file);
 
-    const body = JSON.stringify({ geometries: compact }, matrixAwareReplacer);
+    const body = encodeDefinition(compact);
     return await fetch(`/occ/project?${params}`, {
       method: "POST",
+      headers: { "content-type": recipeContentType },
+      body,
+    });
+  }
+
+  /**
+   * Outlines of every part, cut in its own mid plane, one svg per part.
+   * Parts the server could not section are null.
+   * @returns {Promise<(string | null)[]>}
+   */
+  async sections() {
+    const flat = this.flatInstances();
+    const geometries = Object.values(flat).map(({ item }) => ({
+      part: item.toJson(),
+    }));
+
+    const r = await fetch("/occ/section", {
+      method: "POST",
+      headers: { "content-type": recipeContentType },
+      body: encodeSections(geometries),
+    });
+    const text = await r.text();
+    return text
+      .split("</svg>")
+      .filter((svg) => svg.trim().length)
+      .map((svg) => (svg.includes("data-error") ? null : `${svg.trim()}</svg>`));
+  }
+
+  /**
+   * Lists the pairs of instances that overlap, with their common volume.
+   * The server caps the number of clashes it lists, a warning is logged when
+   * some were left out.
+   * @returns {Promise<{first: {geometry: number, instance: number}, second: {geometry: number, instance: number}, volume: number}[]>}
+   */
+  async clashes() {
+    const flat = this.flatInstances();
+    const compact = Object.values(flat).map(({ item, instances }) => ({
+      part: item.toJson(),
+      instances,
+    }));
+
+    const body = encodeDefinition(compact);
+    const r = await fetch("/occ/clash", {
+      method: "POST",
+      headers: { "content-type": recipeContentType },
       body,
     });
+    const { clashes, truncated } = await r.json();
+    if (truncated)
+      console.warn(`only the first ${clashes.length} clashes are listed`);
+    return clashes;
   }
 }
 
@@ -402,9 +461,10 @@ export class Model extends Assembly {
       instances,
     }));
 
-    const body = JSON.stringify({ geometries: compact }, matrixAwareReplacer);
+    const body = encodeDefinition(compact);
     await fetch(`/occ/export?file=${encodeURI(file)}`, {
       method: "POST",
+      headers: { "content-type": recipeContentType },
       body,
     });
   }
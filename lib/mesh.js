@@ -0,0 +1,108 @@
+// @ts-check
+
+import { encodeMeshBatch, encodeRecipe, recipeContentType } from "./binary.js";
+
+// meshes are cached as "# <etag>\n<obj>", the etag being the one sent back
+// by the server, which changes with the recipe and the meshing parameters
+
+/**
+ * @param {string} name
+ * @returns {{etag: string, mesh: string} | null}
+ */
+function readCache(name) {
+  const key = `solidify__${name}`;
+  const cached = sessionStorage.getItem(key) ?? localStorage.getItem(key);
+  if (!cached?.startsWith("# ")) return null;
+  const end = cached.indexOf("\n");
+  if (end === -1) return null;
+  return { etag: cached.slice(2, end), mesh: cached };
+}
+
+/**
+ * @param {string} name
+ */
+function dropCache(name) {
+  const key = `solidify__${name}`;
+  sessionStorage.removeItem(key);
+  localStorage.removeItem(key);
+}
+
+/**
+ * @param {string} name
+ * @param {string | null} etag
+ * @param {string} obj
+ * @returns {string}
+ */
+function writeCache(name, etag, obj) {
+  const key = `solidify__${name}`;
+  const mesh = `# ${etag ?? ""}\n${obj}`;
+  if (!etag) return mesh;
+  try {
+    sessionStorage.setItem(key, mesh);
+  } catch {
+    try {
+      localStorage.setItem(key, mesh);
+    } catch { console.warn("both local end session storage are full") }
+  }
+  return mesh;
+}
+
+/**
+ * Meshes a single part, the server answers 304 when the cached mesh is
+ * still the right one.
+ * @param {{name: string, toJson(): any}} part
+ * @returns {Promise<string>}
+ */
+export async function fetchMesh(part) {
+  const cached = readCache(part.name);
+  /** @type {Record<string, string>} */
+  const headers = { "content-type": recipeContentType };
+  if (cached) headers["if-none-match"] = cached.etag;
+
+  const r = await fetch("/occ/solidify", {
+    method: "POST",
+    headers,
+    body: encodeRecipe(part.toJson()),
+  });
+  if (r.status === 304 && cached) return cached.mesh;
+  if (!r.ok) throw new Error(`failed to mesh ${part.name}: ${await r.text()}`);
+  return writeCache(part.name, r.headers.get("etag"), await r.text());
+}
+
+/**
+ * Meshes several parts in one request, only the ones that changed since
+ * they were cached are meshed and sent back. Parts the server failed to mesh
+ * get an empty mesh and are not cached.
+ * @param {{name: string, toJson(): any}[]} parts
+ * @returns {Promise<string[]>}
+ */
+export async function fetchMeshes(parts) {
+  const cached = parts.map((part) => readCache(part.name));
+  const body = encodeMeshBatch(
+    parts.map((part, i) => ({
+      part: part.toJson(),
+      etag: cached[i]?.etag ?? null,
+    })),
+  );
+  const r = await fetch("/occ/solidify-batch", {
+    method: "POST",
+    headers: { "content-type": recipeContentType },
+    body,
+  });
+  if (!r.ok) throw new Error(`failed to mesh parts: ${await r.text()}`);
+
+  /** @type {{parts: {index: number, ok: boolean, etag: string | null, mesh: string}[]}} */
+  const { parts: changed } = await r.json();
+  const meshes = cached.map((entry) => entry?.mesh ?? "");
+  for (const { index, ok, etag, mesh } of changed) {
+    const { name } = parts[index];
+    if (!ok) {
+      console.warn(`failed to mesh ${name}`);
+      dropCache(name);
+      meshes[index] = "";
+      continue;
+    }
+    meshes[index] = writeCache(name, etag, mesh);
+  }
+  return meshes;
+}
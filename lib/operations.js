@@ -114,6 +114,101 @@ export function locate(placement, shape) {
   return new ShapeId(registry.length - 1);
 }
 
+/**
+ * Box with a corner at the origin of `placement`, cheaper than extruding a
+ * rectangle.
+ * @param {DOMMatrix} placement
+ * @param {number} dx
+ * @param {number} dy
+ * @param {number} dz
+ * @returns {ShapeId}
+ */
+export function box(placement, dx, dy, dz) {
+  registry.push({
+    type: "box",
+    placement,
+    size: [dx, dy, dz],
+  });
+  return new ShapeId(registry.length - 1);
+}
+
+/**
+ * Cylinder along the z axis of `placement`, from 0 to `length`
+ * @param {DOMMatrix} placement
+ * @param {number} radius
+ * @param {number} length
+ * @returns {ShapeId}
+ */
+export function cylinder(placement, radius, length) {
+  registry.push({
+    type: "cylinder",
+    placement,
+    radius,
+    length,
+  });
+  return new ShapeId(registry.length - 1);
+}
+
+/**
+ * Countersunk hole tool, the entry is at the origin of `placement` and the
+ * hole goes `depth` deep towards its -z
+ * @param {DOMMatrix} placement
+ * @param {number} radius
+ * @param {number} depth
+ * @param {number} headRadius
+ * @param {number} angle included angle of the countersink, in degrees
+ * @returns {ShapeId}
+ */
+export function countersink(placement, radius, depth, headRadius, angle = 90) {
+  registry.push({
+    type: "countersink",
+    placement,
+    radius,
+    length: depth,
+    head_radius: headRadius,
+    rotation: (angle * Math.PI) / 180,
+  });
+  return new ShapeId(registry.length - 1);
+}
+
+/**
+ * `count` copies of `shape`, each one `offset` away from the previous one
+ * @param {ShapeId} shape
+ * @param {number} count
+ * @param {number[]} offset
+ * @returns {ShapeId}
+ */
+export function linearPattern(shape, count, offset) {
+  registry.push({
+    type: "linear_pattern",
+    shape,
+    count,
+    offset,
+  });
+  return new ShapeId(registry.length - 1);
+}
+
+/**
+ * `count` copies of `shape` around the z axis of `axis`, spread over `angle`
+ * degrees (a full turn by default)
+ * @param {ShapeId} shape
+ * @param {number} count
+ * @param {DOMMatrix} axis
+ * @param {number} [angle]
+ * @returns {ShapeId}
+ */
+export function circularPattern(shape, count, axis, angle = 360) {
+  const gaps = angle >= 360 ? count : Math.max(count - 1, 1);
+  registry.push({
+    type: "circular_pattern",
+    shape,
+    count,
+    axis,
+    rotation: (angle * Math.PI) / 180 / gaps,
+  });
+  return new ShapeId(registry.length - 1);
+}
+
 /**
  * @param {ShapeId} shape
  */
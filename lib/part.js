@@ -3,19 +3,8 @@
 import { Path } from "../tools/path.js";
 import { BasePart } from "./lib.js";
 import { retrieveOperations, ShapeId } from "./operations.js";
-import { matrixAwareReplacer } from "./json.js";
-
-const encoder = new TextEncoder();
-
-async function hashString(string) {
-  const data = encoder.encode(string);
-  const hashBuffer = await crypto.subtle.digest("SHA-256", data);
-  const hashArray = Array.from(new Uint8Array(hashBuffer));
-  const hashHex = hashArray
-    .map((b) => b.toString(16).padStart(2, "0"))
-    .join("");
-  return hashHex;
-}
+import { fetchMesh } from "./mesh.js";
+import { encodeQuery, recipeContentType } from "./binary.js";
 
 export class Part extends BasePart {
   /**
@@ -28,31 +17,7 @@ export class Part extends BasePart {
   }
 
   async loadMesh() {
-    const body = JSON.stringify(this.toJson(), matrixAwareReplacer);
-    const hash = await hashString(body);
-    const hashLine = `# ${hash}\n`;
-    const key = `solidify__${this.name}`;
-    const sessionCache = sessionStorage.getItem(key)
-    const localCache = localStorage.getItem(key);
-    if (sessionCache?.startsWith(hashLine)) {
-      this.mesh = sessionCache;
-      return;
-    }
-    if (localCache?.startsWith(hashLine)) {
-      this.mesh = localCache;
-      return;
-    }
-
-    const r = await fetch("/occ/solidify", { method: "POST", body });
-    const file = await r.text();
-    try {
-      sessionStorage.setItem(key, hashLine + file);
-    } catch {
-      try {
-        localStorage.setItem(key, hashLine + file);
-      } catch { console.warn("both local end session storage are full") }
-    }
-    this.mesh = file;
+    this.mesh = await fetchMesh(this);
   }
 
   *getPairings() {
@@ -84,3 +49,41 @@ export class Part extends BasePart {
     return { [this._id]: { item: this, instances: [new DOMMatrix()] } };
   }
 }
+
+/**
+ * @typedef {{
+ *   ok: boolean;
+ *   aabb: {min: number[], max: number[]};
+ *   obb: {center: number[], axes: number[][], half_sizes: number[]};
+ *   volume: number;
+ *   area: number;
+ *   centroid: number[];
+ *   mass: number;
+ *   solids: number;
+ *   faces: number;
+ *   edges: number;
+ * }} PartProperties
+ */
+
+/**
+ * Bounding boxes, volumes and masses of parts, computed by the server
+ * without meshing them. Lengths are in mm and masses in kg.
+ * @param {Part[]} parts
+ * @param {number[]} [densities] in kg/m3, needed for the masses
+ * @returns {Promise<PartProperties[]>}
+ */
+export async function queryParts(parts, densities = []) {
+  const body = encodeQuery(
+    parts.map((part, i) => ({
+      part: part.toJson(),
+      density: densities[i] ?? 0,
+    })),
+  );
+  const r = await fetch("/occ/query", {
+    method: "POST",
+    headers: { "content-type": recipeContentType },
+    body,
+  });
+  const { parts: properties } = await r.json();
+  return properties;
+}
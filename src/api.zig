@@ -1,236 +1,259 @@
 const std = @import("std");
 const parse = @import("parse_path.zig");
 const occ = @import("occ.zig");
+const recipe = @import("recipe.zig");
+const planar = @import("planar.zig");
+const parallel = @import("parallel.zig");
+const utils = @import("utils.zig");
 const Allocator = std.mem.Allocator;
 
 const expect = std.testing.expect;
 const PathSegment = occ.PathSegment;
 
-pub const Transform = [16]f64;
+pub const Transform = recipe.Transform;
+pub const Recipe = recipe.Recipe;
 const fixOrient: Transform = .{ 0, 0, 1, 0, 0, -1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1 };
 
 pub const GeometryInstances = struct {
-    part: std.json.Value,
+    part: Recipe,
     instances: []Transform,
 };
 
 pub const CompactPartDefinition = struct {
     geometries: []GeometryInstances,
-};
-
-pub fn getNumber(val: std.json.Value) !f64 {
-    return switch (val) {
-        .integer => |i| @floatFromInt(i),
-        .float => |f| f,
-        else => return error.NotANumber,
-    };
-}
-
-pub fn parsePath(allocator: Allocator, segmentsArray: *std.ArrayList(PathSegment), path: []const u8) !void {
-    var iterator = parse.SVGPathIterator.init(path);
-    while (try iterator.next()) |val| {
-        try segmentsArray.append(allocator, val);
-    }
-}
-
-pub fn solidify(allocator: std.mem.Allocator, definition: *std.json.Value, output_buffer: [*c]u8) !usize {
-    const shape = try executeShapeRecipe(allocator, definition);
-    defer occ.freeShape(shape);
-
-    const cint_obj_size = occ.writeToOBJ(shape, output_buffer);
-
-    const obj_size: usize = @intCast(cint_obj_size);
-    return obj_size;
-}
-
-pub fn executeShapeRecipe(allocator: std.mem.Allocator, definition: *const std.json.Value) !*occ.Shape {
-    const shapeRecipe = definition.object.get("shape").?.array.items;
-    const nbSteps = shapeRecipe.len;
-    var shapes = try allocator.alloc(*occ.Shape, nbSteps);
-    defer allocator.free(shapes);
-
-    for (shapeRecipe, 0..) |recipeStep, i| {
-        const step = recipeStep.object;
-        const operation = step.get("type").?.string;
-
-        if (std.mem.eql(u8, operation, "extrusion")) {
-            var segments: std.ArrayList(PathSegment) = .empty;
-            // defer allocator.free(segments);
-
-            for (step.get("outsides").?.array.items) |path| {
-                try parsePath(allocator, &segments, path.string);
-            }
-
-            for (step.get("insides").?.array.items) |path| {
-                try parsePath(allocator, &segments, path.string);
-            }
 
-            const size = segments.items.len;
-            const array = try segments.toOwnedSlice(allocator);
-
-            var result = occ.extrudePathWithHoles(array.ptr, size, try getNumber(step.get("length").?));
-
-            if (step.get("placement")) |placement| {
-                const transform = placement.array.items;
-                var mat: Transform = undefined;
-                for (0..15) |j| mat[j] = try getNumber(transform[j]);
-                const trsf = occ.makeTransform(&mat[0]);
-                result = occ.applyShapeLocationTransform(result, trsf);
-            }
-
-            shapes[i] = result.?;
-            continue;
+    /// Reads a definition from its binary encoding, see `recipe.Decoder`:
+    ///
+    ///     definition := "CADD" u8:version u32:count (recipe u32:count transform*)*
+    pub fn decode(allocator: Allocator, bytes: []const u8) recipe.DecodeError!CompactPartDefinition {
+        var decoder = recipe.Decoder.init(bytes);
+        try decoder.header("CADD");
+
+        // a recipe and an instance count
+        const geometries = try allocator.alloc(GeometryInstances, try decoder.count(recipe.min_recipe_size + 4));
+        for (geometries) |*geom| {
+            geom.part = try decoder.recipe(allocator);
+            geom.instances = try allocator.alloc(Transform, try decoder.count(@sizeOf(Transform)));
+            for (geom.instances) |*instance| instance.* = try decoder.transform();
         }
+        return .{ .geometries = geometries };
+    }
+};
 
-        if (std.mem.eql(u8, operation, "sweep")) {
-            var segments: std.ArrayList(PathSegment) = .empty;
+/// Deflections of every mesh written by `writeMesh`, they are part of the mesh
+/// tags so changing them invalidates the meshes cached by clients.
+pub const mesh_parameters: occ.MeshParameters = .{
+    .linearDeflection = 1,
+    .angularDeflection = 0.5,
+    .outlineDeflection = 0.01,
+};
 
-            try parsePath(allocator, &segments, step.get("directrix").?.string);
-            const directrixSize = segments.items.len;
+/// Bump when the OBJ output of writeSolidToObj changes for the same
+/// parameters.
+const mesh_format_version = 1;
 
-            for (step.get("outsides").?.array.items) |path| {
-                try parsePath(allocator, &segments, path.string);
-            }
-            for (step.get("insides").?.array.items) |path| {
-                try parsePath(allocator, &segments, path.string);
-            }
+/// Strong entity tag of the mesh of a recipe, quoted as in an ETag header.
+pub const MeshTag = [18]u8;
 
-            const size = segments.items.len;
-            const array = try segments.toOwnedSlice(allocator);
-
-            var result = occ.sweepPathAlong3DPath(array.ptr, directrixSize, size);
-
-            if (step.get("placement")) |placement| {
-                const transform = placement.array.items;
-                var mat2: Transform = undefined;
-                for (0..15) |j| mat2[j] = try getNumber(transform[j]);
-                result = occ.applyShapeLocationTransform(
-                    result,
-                    occ.makeTransform(&mat2[0]),
-                );
-                result = occ.applyShapeLocationTransform(
-                    result,
-                    occ.makeTransform(&fixOrient[0]),
-                );
-            }
+pub fn meshTag(part: *const Recipe) MeshTag {
+    var hasher = std.hash.Wyhash.init(part.hash());
+    hasher.update(std.mem.asBytes(&mesh_parameters));
+    hasher.update(&.{mesh_format_version});
 
-            shapes[i] = result.?;
-            continue;
-        }
-
-        if (std.mem.eql(u8, operation, "revolve")) {
-            var segments: std.ArrayList(PathSegment) = .empty;
+    var tag: MeshTag = undefined;
+    _ = std.fmt.bufPrint(&tag, "\"{x:0>16}\"", .{hasher.final()}) catch unreachable;
+    return tag;
+}
 
-            try parsePath(allocator, &segments, step.get("path").?.string);
+pub fn solidify(allocator: std.mem.Allocator, definition: *const Recipe, output_buffer: []u8) !usize {
+    const shape = try executeShapeRecipe(allocator, definition);
+    defer occ.freeShape(shape);
 
-            const axis_numbers = step.get("axis").?.array.items;
-            var mat: Transform = undefined;
-            for (0..15) |j| mat[j] = try getNumber(axis_numbers[j]);
-            const axis = occ.makeTransform(&mat[0]);
+    return writeMesh(shape, output_buffer);
+}
 
-            const size = segments.items.len;
-            const array = try segments.toOwnedSlice(allocator);
+/// Writes the OBJ mesh of a shape, fails instead of writing past the buffer.
+pub fn writeMesh(shape: *occ.Shape, output_buffer: []u8) !usize {
+    const cint_obj_size = occ.writeToOBJ(shape, &mesh_parameters, output_buffer.ptr, output_buffer.len);
+    return switch (cint_obj_size) {
+        -2 => error.MeshTooLarge,
+        else => if (cint_obj_size < 0) error.InvalidShape else @intCast(cint_obj_size),
+    };
+}
 
-            const rotation = try getNumber(step.get("rotation").?);
-            var result = occ.revolvePath(array.ptr, size, axis, rotation);
+fn applyPlacement(shape: *occ.Shape, placement: ?Transform) *occ.Shape {
+    var mat = placement orelse return shape;
+    const trsf = occ.makeTransform(&mat[0]);
+    defer occ.freeTransform(trsf);
+    return occ.applyShapeLocationTransform(shape, trsf).?;
+}
 
-            if (step.get("placement")) |placement| {
-                const transform = placement.array.items;
-                var mat2: Transform = undefined;
-                for (0..15) |j| mat2[j] = try getNumber(transform[j]);
-                const trsf = occ.makeTransform(&mat2[0]);
-                result = occ.applyShapeLocationTransform(result, trsf);
-            }
+const FoldedCut = struct {
+    shape: *occ.Shape,
+    profile: planar.Profile,
+    remaining: []const recipe.Operand,
+};
 
-            shapes[i] = result.?;
-            continue;
+/// Cutouts that go straight through an extruded outline become insides of
+/// that outline, so the part is extruded once instead of going through a 3D
+/// boolean per cutout. Returns null when nothing could be folded.
+fn foldThroughCuts(
+    allocator: std.mem.Allocator,
+    base: planar.Profile,
+    operands: []const recipe.Operand,
+    profiles: []const ?planar.Profile,
+    patterns: []const ?planar.Pattern,
+) !?FoldedCut {
+    var segments: std.ArrayList(PathSegment) = .empty;
+    try segments.appendSlice(allocator, base.segments);
+    var remaining: std.ArrayList(recipe.Operand) = .empty;
+
+    for (operands) |operand| {
+        var folded = false;
+        if (profiles[operand.shape]) |cutout| {
+            folded = try planar.foldCutout(allocator, &segments, base, cutout.located(operand.placement));
+        } else if (patterns[operand.shape]) |pattern| {
+            // all the copies or none, the pattern is a single tool otherwise
+            const start = segments.items.len;
+            const located = pattern.located(operand.placement);
+            folded = for (0..located.copies.len) |j| {
+                if (!try planar.foldCutout(allocator, &segments, base, located.copy(j))) break false;
+            } else true;
+            if (!folded) segments.shrinkRetainingCapacity(start);
         }
+        if (!folded) try remaining.append(allocator, operand);
+    }
 
-        if (std.mem.eql(u8, operation, "locate")) {
-            var shape = shapes[@intCast(step.get("shape").?.integer)];
+    if (remaining.items.len == operands.len) return null;
 
-            const placement = step.get("placement").?;
-            const transform = placement.array.items;
+    const shape = occ.tryExtrudePathWithHoles(segments.items.ptr, segments.items.len, base.length) orelse return null;
+    return .{
+        .shape = applyPlacement(shape, base.frame),
+        .profile = .{ .segments = segments.items, .length = base.length, .frame = base.frame },
+        .remaining = remaining.items,
+    };
+}
 
-            var mat: Transform = undefined;
-            for (0..15) |j| mat[j] = try getNumber(transform[j]);
-            const trsf = occ.makeTransform(&mat[0]);
-            shape = occ.applyShapeLocationTransform(shape, trsf).?;
+pub fn executeShapeRecipe(allocator: std.mem.Allocator, definition: *const Recipe) !*occ.Shape {
+    const nbSteps = definition.steps.len;
+    if (nbSteps == 0) return error.EmptyRecipe;
 
-            shapes[i] = shape;
-            continue;
-        }
+    var shapes = try allocator.alloc(*occ.Shape, nbSteps);
+    defer allocator.free(shapes);
 
-        if (std.mem.eql(u8, operation, "fuse")) {
-            const shapeIndexes = step.get("shapes").?.array.items;
-            // i dont know how to not initialize this
-            var currentShape = shapes[0];
-            for (shapeIndexes, 0..) |item, j| {
-                var shape = shapes[@intCast(item.object.get("shape").?.integer)];
-                if (item.object.get("placement")) |placement| {
-                    const transform = placement.array.items;
-                    var mat: Transform = undefined;
-                    for (0..15) |k| mat[k] = try getNumber(transform[j]);
-                    const trsf = occ.makeTransform(&mat[0]);
-                    shape = occ.applyShapeLocationTransform(shape, trsf).?;
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+
+    // outlines of the steps that are plain prisms
+    const profiles = try arena.allocator().alloc(?planar.Profile, nbSteps);
+    @memset(profiles, null);
+    const patterns = try arena.allocator().alloc(?planar.Pattern, nbSteps);
+    @memset(patterns, null);
+
+    for (definition.steps, 0..) |step, i| {
+        switch (step.operation) {
+            .extrusion => {
+                const segments = definition.profileOf(step);
+                const result = occ.extrudePathWithHoles(segments.ptr, segments.len, step.length);
+                shapes[i] = applyPlacement(result.?, step.placement);
+                profiles[i] = .{
+                    .segments = segments,
+                    .length = step.length,
+                    .frame = step.placement orelse recipe.identity,
+                };
+            },
+            .sweep => {
+                // the directrix is directly followed by the profile
+                const directrix = definition.pathOf(step);
+                const segments = definition.segments[step.path.start..step.profile.end()];
+                var result = occ.sweepPathAlong3DPath(segments.ptr, directrix.len, segments.len).?;
+
+                if (step.placement != null) {
+                    result = applyPlacement(result, step.placement);
+                    result = applyPlacement(result, fixOrient);
                 }
 
-                if (j == 0) {
-                    currentShape = shape;
-                } else {
-                    currentShape = occ.fuseShapes(currentShape, shape).?;
+                shapes[i] = result;
+            },
+            .revolve => {
+                const segments = definition.pathOf(step);
+                var mat = step.axis;
+                const axis = occ.makeTransform(&mat[0]);
+                defer occ.freeTransform(axis);
+
+                const result = occ.revolvePath(segments.ptr, segments.len, axis, step.rotation);
+                shapes[i] = applyPlacement(result.?, step.placement);
+            },
+            .locate => {
+                shapes[i] = applyPlacement(shapes[step.shape], step.placement);
+                if (profiles[step.shape]) |profile| profiles[i] = profile.located(step.placement);
+                if (patterns[step.shape]) |pattern| patterns[i] = pattern.located(step.placement);
+            },
+            .box => {
+                shapes[i] = applyPlacement(occ.makeBox(step.size[0], step.size[1], step.size[2]) orelse return error.InvalidDimensions, step.placement);
+                profiles[i] = .{
+                    .segments = try planar.rectangle(arena.allocator(), step.size[0], step.size[1]),
+                    .length = step.size[2],
+                    .frame = step.placement orelse recipe.identity,
+                };
+            },
+            .cylinder => {
+                shapes[i] = applyPlacement(occ.makeCylinder(step.radius, step.length) orelse return error.InvalidDimensions, step.placement);
+                profiles[i] = .{
+                    .segments = try planar.circle(arena.allocator(), step.radius),
+                    .length = step.length,
+                    .frame = step.placement orelse recipe.identity,
+                };
+            },
+            .countersink => {
+                const hole = occ.makeCountersunkHole(step.radius, step.length, step.head_radius, step.rotation) orelse return error.InvalidDimensions;
+                shapes[i] = applyPlacement(hole, step.placement);
+            },
+            .linear_pattern, .circular_pattern => {
+                if (step.count == 0) return error.EmptyOperation;
+                const copies = try planar.patternCopies(arena.allocator(), step);
+                const pattern = occ.patternShape(shapes[step.shape], &copies[0][0], copies.len).?;
+                shapes[i] = applyPlacement(pattern, step.placement);
+                if (profiles[step.shape]) |profile| patterns[i] = .{
+                    .profile = profile,
+                    .copies = copies,
+                    .frame = step.placement orelse recipe.identity,
+                };
+            },
+            .fuse, .intersect => {
+                var currentShape: ?*occ.Shape = null;
+                for (definition.operandsOf(step)) |operand| {
+                    const shape = applyPlacement(shapes[operand.shape], operand.placement);
+                    currentShape = if (currentShape) |current| switch (step.operation) {
+                        .fuse => occ.fuseShapes(current, shape).?,
+                        else => occ.intersectShapes(current, shape).?,
+                    } else shape;
                 }
-            }
-
-            shapes[i] = currentShape;
-            continue;
-        }
 
-        if (std.mem.eql(u8, operation, "intersect")) {
-            const shapeIndexes = step.get("shapes").?.array.items;
-            var currentShape = shapes[0];
-            for (shapeIndexes, 0..) |item, j| {
-                var shape = shapes[@intCast(item.object.get("shape").?.integer)];
-                if (item.object.get("placement")) |placement| {
-                    const transform = placement.array.items;
-                    var mat: Transform = undefined;
-                    for (0..15) |k| mat[k] = try getNumber(transform[j]);
-                    const trsf = occ.makeTransform(&mat[0]);
-                    shape = occ.applyShapeLocationTransform(shape, trsf).?;
+                shapes[i] = currentShape orelse return error.EmptyOperation;
+            },
+            .cut => {
+                var currentShape = shapes[step.shape];
+                var cutouts: []const recipe.Operand = definition.operandsOf(step);
+
+                if (profiles[step.shape]) |base| {
+                    if (try foldThroughCuts(arena.allocator(), base, cutouts, profiles, patterns)) |folded| {
+                        currentShape = folded.shape;
+                        cutouts = folded.remaining;
+                        if (cutouts.len == 0) profiles[i] = folded.profile;
+                    }
                 }
 
-                if (j == 0) {
-                    currentShape = shape;
-                } else {
-                    currentShape = occ.intersectShapes(currentShape, shape).?;
+                // a single boolean for all the cutouts, patterns included
+                const tools = try arena.allocator().alloc(*occ.Shape, cutouts.len);
+                for (cutouts, tools) |operand, *tool| {
+                    tool.* = applyPlacement(shapes[operand.shape], operand.placement);
                 }
-            }
+                if (tools.len != 0) currentShape = occ.cutShapes(currentShape, tools.ptr, tools.len).?;
 
-            shapes[i] = currentShape;
-            continue;
+                shapes[i] = currentShape;
+            },
         }
-
-        if (std.mem.eql(u8, operation, "cut")) {
-            var currentShape = shapes[@intCast(step.get("shape").?.integer)];
-            const cutoutIndexes = step.get("cutouts").?.array.items;
-            for (cutoutIndexes) |item| {
-                var shape = shapes[@intCast(item.object.get("shape").?.integer)];
-                if (item.object.get("placement")) |placement| {
-                    const transform = placement.array.items;
-                    var mat: Transform = undefined;
-                    for (0..15) |j| mat[j] = try getNumber(transform[j]);
-                    const trsf = occ.makeTransform(&mat[0]);
-                    shape = occ.applyShapeLocationTransform(shape, trsf).?;
-                }
-                currentShape = occ.cutShape(currentShape, shape).?;
-            }
-
-            shapes[i] = currentShape;
-            continue;
-        }
-
-        std.debug.print("could not understand operation {s}\n", .{operation});
-        return error.TypeError;
     }
 
     return shapes[nbSteps - 1];
@@ -248,14 +271,78 @@ pub fn assembleCompound(allocator: std.mem.Allocator, compound: *occ.Compound, d
     }
 }
 
-pub fn exportAsSTEP(allocator: std.mem.Allocator, definition: *CompactPartDefinition) !void {
+pub const InstanceRef = struct {
+    geometry: usize,
+    instance: usize,
+};
+
+pub const InstanceClash = struct {
+    first: InstanceRef,
+    second: InstanceRef,
+    volume: f64,
+};
+
+const max_clashes: usize = 100_000;
+
+pub const ClashReport = struct {
+    clashes: []InstanceClash,
+    /// more clashes were found than listed in `clashes`
+    truncated: bool,
+};
+
+/// Lists the pairs of instances that overlap in the definition, along with
+/// the volume they share. Instances are placed as in `assembleCompound`.
+/// The clashes belong to the caller.
+pub fn findClashes(allocator: std.mem.Allocator, definition: *const CompactPartDefinition) !ClashReport {
+    var shapes: std.ArrayList(*occ.Shape) = .empty;
+    defer {
+        for (shapes.items) |shape| occ.freeShape(shape);
+        shapes.deinit(allocator);
+    }
+    var refs: std.ArrayList(InstanceRef) = .empty;
+    defer refs.deinit(allocator);
+
+    for (definition.geometries, 0..) |geom, i| {
+        const shape = try executeShapeRecipe(allocator, &geom.part);
+        defer occ.freeShape(shape);
+
+        for (geom.instances, 0..) |instance, j| {
+            var mat: Transform = instance;
+            const transform = occ.makeTransform(&mat[0]);
+            defer occ.freeTransform(transform);
+
+            try shapes.append(allocator, occ.locateShape(shape, transform).?);
+            try refs.append(allocator, .{ .geometry = i, .instance = j });
+        }
+    }
+
+    const nb_shapes = shapes.items.len;
+    const capacity = @min(nb_shapes * nb_shapes / 2, max_clashes);
+    const clashes = try allocator.alloc(occ.Clash, capacity);
+    defer allocator.free(clashes);
+
+    const found = occ.findClashes(shapes.items.ptr, nb_shapes, clashes.ptr, capacity);
+    const length = @min(found, capacity);
+
+    var result = try allocator.alloc(InstanceClash, length);
+    for (clashes[0..length], 0..) |clash, i| {
+        result[i] = .{
+            .first = refs.items[clash.first],
+            .second = refs.items[clash.second],
+            .volume = clash.volume,
+        };
+    }
+    return .{ .clashes = result, .truncated = found > length };
+}
+
+pub fn exportAsSTEP(allocator: std.mem.Allocator, definition: *const CompactPartDefinition) !void {
     const compound = occ.makeCompound().?;
     defer occ.freeCompound(compound);
 
     try assembleCompound(allocator, compound, definition);
 
     var filepath = "C:/Users/kipr/Downloads/test.step";
-    occ.saveToSTEP(compound, &filepath[0]);
+    if (occ.saveToSTEP(compound, &filepath[0]) != 0) return error.StepExportFailed;
 }
 
 pub fn projectSVG(allocator: std.mem.Allocator, definition: *const CompactPartDefinition, filepath: []const u8) !void {
@@ -264,14 +351,6 @@ pub fn projectSVG(allocator: std.mem.Allocator, definition: *const CompactPartDe
 
     try assembleCompound(allocator, compound, definition);
 
-    // const filepath = "./schema.svg";
-    const max_capacity = 1e5;
-
-    var items: [max_capacity]PathSegment = @splat(.{});
-    const array = items[0..];
-
-    const length = occ.shapeToSVGSegments(compound, array.ptr, max_capacity);
-
     var threaded: std.Io.Threaded = .init_single_threaded;
     const io = threaded.io();
     const file = try std.Io.Dir.cwd().createFile(io, filepath, .{});
@@ -280,7 +359,7 @@ pub fn projectSVG(allocator: std.mem.Allocator, definition: *const CompactPartDe
     var file_writer = file.writer(io, &.{});
     const writer = &file_writer.interface;
 
-    try parse.writeSegmentsToSVG(writer, array[0..length]);
+    const length = try writeCompoundSVG(allocator, compound, writer);
     try writer.flush();
     std.debug.print("successfully wrote svg file with {d} segments\n", .{length});
 }
@@ -291,16 +370,315 @@ pub fn projectSVGInMemory(allocator: std.mem.Allocator, definition: *const Compa
 
     try assembleCompound(allocator, compound, definition);
 
+    const length = try writeCompoundSVG(allocator, compound, writer);
+
+    std.debug.print("successfully wrote svg with {d} segments\n", .{length});
+}
+
+/// Projects the visible edges of the compound and writes them as an SVG
+/// document, returns the number of segments written.
+pub fn writeCompoundSVG(allocator: std.mem.Allocator, compound: *occ.Compound, writer: *std.Io.Writer) !usize {
     const max_capacity = 1e5;
 
-    var items: [max_capacity]PathSegment = @splat(.{});
-    const array = items[0..];
+    const items = try allocator.alloc(PathSegment, max_capacity);
+    defer allocator.free(items);
+    @memset(items, .{});
+
+    const length = occ.shapeToSVGSegments(compound, items.ptr, max_capacity);
+    if (length > max_capacity) return error.SvgTooLarge;
 
-    const length = occ.shapeToSVGSegments(compound, array.ptr, max_capacity);
+    try parse.writeSegmentsToSVG(writer, items[0..length]);
+    return length;
+}
 
-    try parse.writeSegmentsToSVG(writer, array[0..length]);
+pub const SectionGeometry = struct {
+    part: Recipe,
+    /// the section is made in the XY plane of this transform, defaults to the
+    /// mid plane of the first extrusion of the part
+    plane: ?Transform = null,
+};
 
-    std.debug.print("successfully wrote svg with {d} segments\n", .{length});
+pub const SectionDefinition = struct {
+    geometries: []SectionGeometry,
+
+    /// Reads a definition from its binary encoding, see `recipe.Decoder`:
+    ///
+    ///     definition := "CADS" u8:version u32:count (recipe u8:has_plane [transform])*
+    pub fn decode(allocator: Allocator, bytes: []const u8) recipe.DecodeError!SectionDefinition {
+        var decoder = recipe.Decoder.init(bytes);
+        try decoder.header("CADS");
+
+        const geometries = try allocator.alloc(SectionGeometry, try decoder.count(recipe.min_recipe_size + 1));
+        for (geometries) |*geom| {
+            geom.part = try decoder.recipe(allocator);
+            geom.plane = try decoder.optionalTransform();
+        }
+        return .{ .geometries = geometries };
+    }
+};
+
+/// Mid plane of the first step that makes a solid out of nothing, all of
+/// them go along the Z axis of their placement.
+fn defaultSectionPlane(part: *const Recipe) Transform {
+    for (part.steps) |step| {
+        const height = switch (step.operation) {
+            .extrusion, .cylinder => step.length,
+            .box => step.size[2],
+            else => continue,
+        };
+        var mid = recipe.identity;
+        mid[14] = height / 2;
+        return planar.multiply(step.placement orelse recipe.identity, mid);
+    }
+    return recipe.identity;
+}
+
+const Section = struct {
+    ok: bool = false,
+    buffer: []PathSegment = &.{},
+    length: usize = 0,
+};
+
+/// Written in place of the section of a part that could not be evaluated.
+const failed_section = "<svg xmlns=\"http://www.w3.org/2000/svg\" data-error=\"section failed\"></svg>";
+
+const SectionJob = struct {
+    allocator: std.mem.Allocator,
+    geometries: []const SectionGeometry,
+    results: []Section,
+
+    fn run(self: *const SectionJob, i: usize) anyerror!void {
+        const geom = &self.geometries[i];
+        const shape = try executeShapeRecipe(self.allocator, &geom.part);
+        defer occ.freeShape(shape);
+
+        var mat = geom.plane orelse defaultSectionPlane(&geom.part);
+        const plane = occ.makeTransform(&mat[0]);
+        defer occ.freeTransform(plane);
+
+        const max_capacity = 1e5;
+        const buffer = try self.allocator.alloc(PathSegment, max_capacity);
+        defer self.allocator.free(buffer);
+        @memset(buffer, .{});
+
+        // an empty section means the plane missed the part or the section
+        // failed, either way there is nothing meaningful to draw
+        const length = occ.sectionToSVGSegments(shape, plane, buffer.ptr, max_capacity);
+        if (length == 0) return error.EmptySection;
+        if (length > max_capacity) return error.SvgTooLarge;
+
+        self.results[i] = .{
+            .ok = true,
+            .buffer = try self.allocator.dupe(PathSegment, buffer[0..length]),
+            .length = length,
+        };
+    }
+};
+
+/// Sections every geometry with its own plane, in parallel, and writes one
+/// SVG document per geometry in the request order. Geometries that fail get
+/// an empty document with a `data-error` attribute.
+pub fn sectionSVGInMemory(allocator: std.mem.Allocator, definition: *const SectionDefinition, writer: *std.Io.Writer) !void {
+    const geometries = definition.geometries;
+    const results = try allocator.alloc(Section, geometries.len);
+    defer {
+        for (results) |section| allocator.free(section.buffer);
+        allocator.free(results);
+    }
+    @memset(results, .{});
+
+    const job: SectionJob = .{ .allocator = allocator, .geometries = geometries, .results = results };
+    parallel.forEach(geometries.len, &job, SectionJob.run);
+
+    var total: usize = 0;
+    var failed: usize = 0;
+    for (results) |section| {
+        if (section.ok) {
+            try parse.writeSegmentsToSVG(writer, section.buffer[0..section.length]);
+        } else {
+            _ = try writer.write(failed_section);
+            failed += 1;
+        }
+        _ = try writer.write("\n");
+        total += section.length;
+    }
+
+    std.debug.print("successfully wrote {d} sections with {d} segments, {d} failed\n", .{ geometries.len - failed, total, failed });
+}
+
+pub const PartQuery = struct {
+    part: Recipe,
+    /// in kg/m3, only used to compute the mass
+    density: f64 = 0,
+};
+
+pub const QueryDefinition = struct {
+    parts: []PartQuery,
+
+    /// Reads a definition from its binary encoding, see `recipe.Decoder`:
+    ///
+    ///     definition := "CADQ" u8:version u32:count (recipe f64:density)*
+    pub fn decode(allocator: Allocator, bytes: []const u8) recipe.DecodeError!QueryDefinition {
+        var decoder = recipe.Decoder.init(bytes);
+        try decoder.header("CADQ");
+
+        const parts = try allocator.alloc(PartQuery, try decoder.count(recipe.min_recipe_size + 8));
+        for (parts) |*query| {
+            query.part = try decoder.recipe(allocator);
+            query.density = try decoder.float();
+        }
+        return .{ .parts = parts };
+    }
+};
+
+pub const PartProperties = struct {
+    ok: bool = false,
+    aabb: struct { min: [3]f64, max: [3]f64 } = .{ .min = @splat(0), .max = @splat(0) },
+    obb: struct { center: [3]f64, axes: [3][3]f64, half_sizes: [3]f64 } = .{
+        .center = @splat(0),
+        .axes = @splat(@splat(0)),
+        .half_sizes = @splat(0),
+    },
+    /// in mm3
+    volume: f64 = 0,
+    /// in mm2
+    area: f64 = 0,
+    centroid: [3]f64 = @splat(0),
+    /// in kg
+    mass: f64 = 0,
+    solids: usize = 0,
+    faces: usize = 0,
+    edges: usize = 0,
+};
+
+const QueryJob = struct {
+    allocator: std.mem.Allocator,
+    parts: []const PartQuery,
+    results: []PartProperties,
+
+    fn run(self: *const QueryJob, i: usize) anyerror!void {
+        const query = &self.parts[i];
+        const shape = try executeShapeRecipe(self.allocator, &query.part);
+        defer occ.freeShape(shape);
+
+        var props: occ.ShapeProperties = undefined;
+        occ.computeShapeProperties(shape, &props);
+
+        self.results[i] = .{
+            .ok = true,
+            .aabb = .{ .min = props.aabb[0..3].*, .max = props.aabb[3..6].* },
+            .obb = .{
+                .center = props.obbCenter,
+                .axes = .{ props.obbAxes[0..3].*, props.obbAxes[3..6].*, props.obbAxes[6..9].* },
+                .half_sizes = props.obbHalfSizes,
+            },
+            .volume = props.volume,
+            .area = props.area,
+            .centroid = props.centroid,
+            .mass = props.volume * 1e-9 * query.density,
+            .solids = props.nbSolids,
+            .faces = props.nbFaces,
+            .edges = props.nbEdges,
+        };
+    }
+};
+
+/// Evaluates the parts in parallel and reads their geometric properties from
+/// the B-rep, without meshing. Parts that fail keep `ok` to false.
+pub fn queryParts(allocator: std.mem.Allocator, definition: *const QueryDefinition) ![]PartProperties {
+    const results = try allocator.alloc(PartProperties, definition.parts.len);
+    @memset(results, .{});
+
+    const job: QueryJob = .{ .allocator = allocator, .parts = definition.parts, .results = results };
+    parallel.forEach(definition.parts.len, &job, QueryJob.run);
+
+    return results;
+}
+
+pub const MeshRequest = struct {
+    part: Recipe,
+    /// tag of the mesh the client already has
+    etag: ?[]const u8 = null,
+};
+
+pub const MeshBatch = struct {
+    parts: []MeshRequest,
+
+    /// Reads a batch from its binary encoding, see `recipe.Decoder`, an empty
+    /// tag means the client has no mesh for the part:
+    ///
+    ///     batch := "CADM" u8:version u32:count (recipe string:etag)*
+    pub fn decode(allocator: Allocator, bytes: []const u8) recipe.DecodeError!MeshBatch {
+        var decoder = recipe.Decoder.init(bytes);
+        try decoder.header("CADM");
+
+        const parts = try allocator.alloc(MeshRequest, try decoder.count(recipe.min_recipe_size + 4));
+        for (parts) |*request| {
+            request.part = try decoder.recipe(allocator);
+            const etag = try decoder.string();
+            request.etag = if (etag.len == 0) null else etag;
+        }
+        return .{ .parts = parts };
+    }
+};
+
+pub const MeshResult = struct {
+    index: usize,
+    /// false when the part could not be meshed, it then has no tag
+    ok: bool = false,
+    etag: ?MeshTag = null,
+    mesh: []const u8 = "",
+};
+
+const MeshJob = struct {
+    allocator: std.mem.Allocator,
+    parts: []const MeshRequest,
+    results: []MeshResult,
+
+    fn run(self: *const MeshJob, i: usize) anyerror!void {
+        const result = &self.results[i];
+
+        const buffer = try self.allocator.alloc(u8, mesh_buffer_size);
+        defer self.allocator.free(buffer);
+
+        const part = &self.parts[result.index].part;
+        const obj_size = try solidify(self.allocator, part, buffer);
+        if (obj_size == 0) return error.EmptyMesh;
+
+        result.mesh = try self.allocator.dupe(u8, buffer[0..obj_size]);
+        result.etag = meshTag(part);
+        result.ok = true;
+    }
+};
+
+pub const mesh_buffer_size = 1024 * 1024;
+
+/// Meshes, in parallel, only the parts whose tag differs from the one the
+/// client sent. Parts that fail are listed with `ok` false and no tag. Meshes
+/// of the results belong to the caller, see `freeMeshResults`.
+pub fn solidifyChanged(allocator: std.mem.Allocator, batch: *const MeshBatch) ![]MeshResult {
+    var changed: std.ArrayList(MeshResult) = .empty;
+    errdefer changed.deinit(allocator);
+
+    for (batch.parts, 0..) |*request, i| {
+        const tag = meshTag(&request.part);
+        if (request.etag) |etag| {
+            if (utils.tagMatches(etag, &tag)) continue;
+        }
+        try changed.append(allocator, .{ .index = i });
+    }
+
+    const job: MeshJob = .{ .allocator = allocator, .parts = batch.parts, .results = changed.items };
+    parallel.forEach(changed.items.len, &job, MeshJob.run);
+
+    return changed.toOwnedSlice(allocator);
+}
+
+pub fn freeMeshResults(allocator: std.mem.Allocator, results: []MeshResult) void {
+    for (results) |result| {
+        if (result.mesh.len != 0) allocator.free(result.mesh);
+    }
+    allocator.free(results);
 }
 
 test "simple" {
@@ -328,3 +706,76 @@ test "projects a definition" {
 
     try projectSVG(allocator, &parsed.value);
 }
+
+test defaultSectionPlane {
+    const parsed = try std.json.parseFromSlice(Recipe, std.testing.allocator,
+        \\ {"shape":[{"type":"box","size":[100,50,18]},{"type":"cylinder","radius":2.5,"length":10}]}
+    , .{ .ignore_unknown_fields = true });
+    defer parsed.deinit();
+
+    try std.testing.expectEqual(9, defaultSectionPlane(&parsed.value)[14]);
+}
+
+test "meshing located copies once matches meshing every face" {
+    const allocator = std.testing.allocator;
+
+    const recipes = [_][]const u8{
+        \\ {"shape":[
+        \\   {"type":"cylinder","radius":2.5,"length":18},
+        \\   {"type":"linear_pattern","shape":0,"count":8,"offset":[32,0,0]}
+        \\ ]}
+        ,
+        \\ {"shape":[
+        \\   {"type":"box","size":[300,50,18]},
+        \\   {"type":"cylinder","placement":[1,0,0,0,0,1,0,0,0,0,1,0,16,25,0,1],"radius":2.5,"length":18},
+        \\   {"type":"linear_pattern","shape":1,"count":8,"offset":[32,0,0]},
+        \\   {"type":"cut","shape":0,"cutouts":[{"shape":2}]}
+        \\ ]}
+    };
+
+    const shared = try allocator.alloc(u8, 16 * 1024 * 1024);
+    defer allocator.free(shared);
+    const per_face = try allocator.alloc(u8, 16 * 1024 * 1024);
+    defer allocator.free(per_face);
+
+    for (recipes) |json| {
+        const parsed = try std.json.parseFromSlice(Recipe, allocator, json, .{});
+        defer parsed.deinit();
+
+        // separate shapes so that neither path reuses the other's triangulation
+        const first = try executeShapeRecipe(allocator, &parsed.value);
+        defer occ.freeShape(first);
+        const second = try executeShapeRecipe(allocator, &parsed.value);
+        defer occ.freeShape(second);
+
+        const shared_len = try writeMesh(first, shared);
+        const per_face_len = occ.writeToOBJPerFace(second, &mesh_parameters, per_face.ptr, per_face.len);
+        try std.testing.expect(per_face_len > 0);
+
+        var expected = std.mem.splitScalar(u8, per_face[0..@intCast(per_face_len)], '\n');
+        var actual = std.mem.splitScalar(u8, shared[0..shared_len], '\n');
+        var vertices: usize = 0;
+        var triangles: usize = 0;
+        while (expected.next()) |line| {
+            const other = actual.next() orelse return error.TestUnexpectedResult;
+            if (!std.mem.startsWith(u8, line, "v ")) {
+                // triangles and outlines index the vertices, they must match exactly
+                if (std.mem.startsWith(u8, line, "f ")) triangles += 1;
+                try std.testing.expectEqualStrings(line, other);
+                continue;
+            }
+
+            if (!std.mem.startsWith(u8, other, "v ")) return error.TestUnexpectedResult;
+            vertices += 1;
+            var a = std.mem.tokenizeScalar(u8, line[2..], ' ');
+            var b = std.mem.tokenizeScalar(u8, other[2..], ' ');
+            for (0..3) |_| {
+                const x = try std.fmt.parseFloat(f64, a.next().?);
+                const y = try std.fmt.parseFloat(f64, (b.next() orelse return error.TestUnexpectedResult));
+                try std.testing.expectApproxEqAbs(x, y, 1e-6);
+            }
+        }
+        try std.testing.expectEqual(null, actual.next());
+        try std.testing.expect(vertices > 0 and triangles > 0);
+    }
+}
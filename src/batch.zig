@@ -0,0 +1,442 @@
+const std = @import("std");
+const api = @import("api.zig");
+const occ = @import("occ.zig");
+const recipe = @import("recipe.zig");
+const parallel = @import("parallel.zig");
+const Allocator = std.mem.Allocator;
+
+const print = std.debug.print;
+
+const max_recipe_size = 64 * 1024 * 1024;
+const mesh_buffer_size = 16 * 1024 * 1024;
+
+const usage =
+    \\usage: cade batch <manifest.json | directory> [--out <directory>] [--outputs mesh,svg,step]
+    \\
+    \\A manifest looks like
+    \\  {"output": "out", "jobs": [{"name": "shelf", "recipe": "shelf.json", "outputs": ["mesh", "step"]}]}
+    \\with recipe paths relative to the manifest. When given a directory, every
+    \\.json, .cadr and .cadd file in it becomes a job with the outputs given by
+    \\--outputs (mesh by default). Recipes are either a single part, as posted to
+    \\/occ/solidify, or a definition with geometries, as posted to /occ/project.
+    \\
+;
+
+pub const Output = enum { mesh, svg, step };
+
+const Outputs = std.EnumSet(Output);
+
+const ManifestJob = struct {
+    name: ?[]const u8 = null,
+    recipe: []const u8,
+    outputs: []const Output = &.{.mesh},
+};
+
+const Manifest = struct {
+    output: []const u8 = "batch-output",
+    jobs: []const ManifestJob,
+};
+
+const JobReport = struct {
+    name: []const u8,
+    recipe: []const u8,
+    ok: bool = false,
+    @"error": ?[]const u8 = null,
+    load_ms: f64 = 0,
+    mesh_ms: f64 = 0,
+    svg_ms: f64 = 0,
+    step_ms: f64 = 0,
+    total_ms: f64 = 0,
+};
+
+const Job = struct {
+    recipe: []const u8,
+    outputs: Outputs,
+    report: JobReport,
+};
+
+/// Evaluated shapes shared by all the jobs of a batch, keyed by recipe hash.
+/// An entry is filled once, under its own lock, and is only read afterwards:
+/// meshing writes triangulations into the shape so it happens right after the
+/// evaluation when any job asks for meshes.
+const ShapeCache = struct {
+    const Entry = struct {
+        mutex: std.Thread.Mutex = .{},
+        shape: ?*occ.Shape = null,
+        mesh: ?[]u8 = null,
+    };
+
+    allocator: Allocator,
+    with_meshes: bool,
+    mutex: std.Thread.Mutex = .{},
+    entries: std.AutoHashMapUnmanaged(u64, *Entry) = .empty,
+    hits: std.atomic.Value(usize) = .init(0),
+    misses: std.atomic.Value(usize) = .init(0),
+
+    fn deinit(self: *ShapeCache) void {
+        var it = self.entries.valueIterator();
+        while (it.next()) |entry| {
+            if (entry.*.shape) |shape| occ.freeShape(shape);
+            if (entry.*.mesh) |mesh| self.allocator.free(mesh);
+            self.allocator.destroy(entry.*);
+        }
+        self.entries.deinit(self.allocator);
+    }
+
+    fn entryFor(self: *ShapeCache, key: u64) !*Entry {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const result = try self.entries.getOrPut(self.allocator, key);
+        if (!result.found_existing) {
+            result.value_ptr.* = try self.allocator.create(Entry);
+            result.value_ptr.*.* = .{};
+        }
+        return result.value_ptr.*;
+    }
+
+    fn get(self: *ShapeCache, part: *const recipe.Recipe) !*Entry {
+        const entry = try self.entryFor(part.hash());
+
+        entry.mutex.lock();
+        defer entry.mutex.unlock();
+
+        if (entry.shape != null) {
+            _ = self.hits.fetchAdd(1, .monotonic);
+            return entry;
+        }
+        _ = self.misses.fetchAdd(1, .monotonic);
+
+        const shape = try api.executeShapeRecipe(self.allocator, part);
+        errdefer occ.freeShape(shape);
+
+        if (self.with_meshes) {
+            const buffer = try self.allocator.alloc(u8, mesh_buffer_size);
+            defer self.allocator.free(buffer);
+
+            const obj_size = try api.writeMesh(shape, buffer);
+            entry.mesh = try self.allocator.dupe(u8, buffer[0..obj_size]);
+        }
+
+        entry.shape = shape;
+        return entry;
+    }
+};
+
+const Batch = struct {
+    allocator: Allocator,
+    io: std.Io,
+    out_dir: []const u8,
+    jobs: []Job,
+    cache: ShapeCache,
+    // the STEP writer relies on global state
+    step_mutex: std.Thread.Mutex = .{},
+};
+
+fn now(io: std.Io) i96 {
+    const timestamp = std.Io.Clock.awake.now(io) catch return 0;
+    return timestamp.nanoseconds;
+}
+
+fn millisSince(io: std.Io, start: i96) f64 {
+    return @as(f64, @floatFromInt(now(io) - start)) / std.time.ns_per_ms;
+}
+
+fn loadDefinition(allocator: Allocator, bytes: []const u8) !api.CompactPartDefinition {
+    if (std.mem.startsWith(u8, bytes, "CADD")) return api.CompactPartDefinition.decode(allocator, bytes);
+
+    const part = if (std.mem.startsWith(u8, bytes, "CADR"))
+        try recipe.Recipe.decode(allocator, bytes)
+    else blk: {
+        const options: std.json.ParseOptions = .{ .ignore_unknown_fields = true };
+        if (std.json.parseFromSliceLeaky(api.CompactPartDefinition, allocator, bytes, options)) |definition| {
+            return definition;
+        } else |err| switch (err) {
+            error.MissingField => break :blk try std.json.parseFromSliceLeaky(recipe.Recipe, allocator, bytes, options),
+            else => return err,
+        }
+    };
+
+    // a single part is a definition with one instance at the origin
+    const geometries = try allocator.alloc(api.GeometryInstances, 1);
+    const instances = try allocator.alloc(api.Transform, 1);
+    instances[0] = recipe.identity;
+    geometries[0] = .{ .part = part, .instances = instances };
+    return .{ .geometries = geometries };
+}
+
+fn writeFile(io: std.Io, path: []const u8, content: []const u8) !void {
+    const file = try std.Io.Dir.cwd().createFile(io, path, .{});
+    defer file.close(io);
+    try file.writePositionalAll(io, content, 0);
+}
+
+fn assemble(batch: *Batch, compound: *occ.Compound, definition: *const api.CompactPartDefinition) !void {
+    for (definition.geometries) |*geom| {
+        const entry = try batch.cache.get(&geom.part);
+
+        for (geom.instances) |instance| {
+            var mat: api.Transform = instance;
+            const transform = occ.makeTransform(&mat[0]);
+            defer occ.freeTransform(transform);
+            occ.addShapeToCompound(compound, entry.shape.?, transform);
+        }
+    }
+}
+
+fn runJob(batch: *Batch, index: usize) anyerror!void {
+    const job = &batch.jobs[index];
+    const io = batch.io;
+    const start = now(io);
+
+    processJob(batch, job) catch |err| {
+        job.report.@"error" = @errorName(err);
+        std.log.err("{s} failed: {s}", .{ job.report.name, @errorName(err) });
+    };
+
+    job.report.total_ms = millisSince(io, start);
+}
+
+fn processJob(batch: *Batch, job: *Job) !void {
+    const io = batch.io;
+    const name = job.report.name;
+
+    var arena_state = std.heap.ArenaAllocator.init(batch.allocator);
+    defer arena_state.deinit();
+    const arena = arena_state.allocator();
+
+    var start = now(io);
+    const bytes = try std.Io.Dir.cwd().readFileAlloc(io, job.recipe, arena, .limited(max_recipe_size));
+    const definition = try loadDefinition(arena, bytes);
+    job.report.load_ms = millisSince(io, start);
+
+    if (job.outputs.contains(.mesh)) {
+        start = now(io);
+        for (definition.geometries, 0..) |*geom, i| {
+            const entry = try batch.cache.get(&geom.part);
+            const path = if (definition.geometries.len == 1)
+                try std.fmt.allocPrint(arena, "{s}/{s}.obj", .{ batch.out_dir, name })
+            else
+                try std.fmt.allocPrint(arena, "{s}/{s}-{d}.obj", .{ batch.out_dir, name, i });
+            try writeFile(io, path, entry.mesh orelse return error.MissingMesh);
+        }
+        job.report.mesh_ms = millisSince(io, start);
+    }
+
+    if (!job.outputs.contains(.svg) and !job.outputs.contains(.step)) {
+        job.report.ok = true;
+        return;
+    }
+
+    const compound = occ.makeCompound().?;
+    defer occ.freeCompound(compound);
+    try assemble(batch, compound, &definition);
+
+    if (job.outputs.contains(.svg)) {
+        start = now(io);
+        var svg: std.Io.Writer.Allocating = .init(arena);
+        _ = try api.writeCompoundSVG(arena, compound, &svg.writer);
+
+        const path = try std.fmt.allocPrint(arena, "{s}/{s}.svg", .{ batch.out_dir, name });
+        try writeFile(io, path, svg.written());
+        job.report.svg_ms = millisSince(io, start);
+    }
+
+    if (job.outputs.contains(.step)) {
+        start = now(io);
+        const path = try std.fmt.allocPrintSentinel(arena, "{s}/{s}.step", .{ batch.out_dir, name }, 0);
+
+        batch.step_mutex.lock();
+        defer batch.step_mutex.unlock();
+        if (occ.saveToSTEP(compound, path.ptr) != 0) return error.StepExportFailed;
+        job.report.step_ms = millisSince(io, start);
+    }
+
+    job.report.ok = true;
+}
+
+fn parseOutputs(list: []const u8) !Outputs {
+    var outputs: Outputs = .initEmpty();
+    var it = std.mem.splitScalar(u8, list, ',');
+    while (it.next()) |item| {
+        outputs.insert(std.meta.stringToEnum(Output, item) orelse return error.UnknownOutput);
+    }
+    return outputs;
+}
+
+fn jobsFromManifest(arena: Allocator, io: std.Io, path: []const u8, out_dir: *[]const u8) ![]Job {
+    const bytes = try std.Io.Dir.cwd().readFileAlloc(io, path, arena, .limited(max_recipe_size));
+    const manifest = try std.json.parseFromSliceLeaky(Manifest, arena, bytes, .{ .ignore_unknown_fields = true });
+
+    if (out_dir.len == 0) out_dir.* = manifest.output;
+    const base = std.fs.path.dirname(path) orelse ".";
+
+    const jobs = try arena.alloc(Job, manifest.jobs.len);
+    for (manifest.jobs, jobs) |item, *job| {
+        const recipe_path = try std.fs.path.join(arena, &.{ base, item.recipe });
+        const name = item.name orelse std.fs.path.stem(item.recipe);
+        job.* = .{
+            .recipe = recipe_path,
+            .outputs = .initMany(item.outputs),
+            .report = .{ .name = name, .recipe = recipe_path },
+        };
+    }
+    return jobs;
+}
+
+fn jobsFromDirectory(arena: Allocator, io: std.Io, path: []const u8, outputs: Outputs) ![]Job {
+    var dir = try std.Io.Dir.cwd().openDir(io, path, .{ .iterate = true });
+    defer dir.close(io);
+
+    var jobs: std.ArrayList(Job) = .empty;
+    var it = dir.iterate();
+    while (try it.next(io)) |entry| {
+        if (entry.kind != .file) continue;
+
+        const ext = std.fs.path.extension(entry.name);
+        if (!std.mem.eql(u8, ext, ".json") and !std.mem.eql(u8, ext, ".cadr") and !std.mem.eql(u8, ext, ".cadd")) continue;
+
+        const recipe_path = try std.fs.path.join(arena, &.{ path, entry.name });
+        const name = try arena.dupe(u8, std.fs.path.stem(entry.name));
+        try jobs.append(arena, .{
+            .recipe = recipe_path,
+            .outputs = outputs,
+            .report = .{ .name = name, .recipe = recipe_path },
+        });
+    }
+    return jobs.toOwnedSlice(arena);
+}
+
+/// Outputs are named after their job, so two jobs with the same name would
+/// overwrite each other's files, e.g. `shelf.json` and `shelf.cadr` in the
+/// same directory.
+fn duplicateName(arena: Allocator, jobs: []const Job) !?[]const u8 {
+    var names: std.StringHashMapUnmanaged(void) = .empty;
+    for (jobs) |job| {
+        const entry = try names.getOrPut(arena, job.report.name);
+        if (entry.found_existing) return job.report.name;
+    }
+    return null;
+}
+
+/// Entry point of `cade batch`, generates the outputs of every job in
+/// parallel and writes a timing report next to them.
+pub fn run(allocator: Allocator, io: std.Io, args: []const []const u8) !void {
+    var arena_state = std.heap.ArenaAllocator.init(allocator);
+    defer arena_state.deinit();
+    const arena = arena_state.allocator();
+
+    var input: ?[]const u8 = null;
+    var out_dir: []const u8 = "";
+    var outputs: Outputs = .initOne(.mesh);
+
+    var i: usize = 0;
+    while (i < args.len) : (i += 1) {
+        const arg = args[i];
+        if (std.mem.eql(u8, arg, "--out") and i + 1 < args.len) {
+            i += 1;
+            out_dir = args[i];
+        } else if (std.mem.eql(u8, arg, "--outputs") and i + 1 < args.len) {
+            i += 1;
+            outputs = parseOutputs(args[i]) catch {
+                print("unknown output in {s}\n{s}", .{ args[i], usage });
+                return error.InvalidArguments;
+            };
+        } else if (input == null) {
+            input = arg;
+        } else {
+            print("unexpected argument {s}\n{s}", .{ arg, usage });
+            return error.InvalidArguments;
+        }
+    }
+
+    const input_path = input orelse {
+        print("{s}", .{usage});
+        return error.InvalidArguments;
+    };
+
+    const is_directory = if (std.Io.Dir.cwd().statFile(io, input_path, .{})) |stat|
+        stat.kind == .directory
+    else |err| switch (err) {
+        error.IsDir => true,
+        else => return err,
+    };
+    const jobs = if (is_directory)
+        try jobsFromDirectory(arena, io, input_path, outputs)
+    else
+        try jobsFromManifest(arena, io, input_path, &out_dir);
+
+    if (try duplicateName(arena, jobs)) |name| {
+        print("several jobs are named {s}, their outputs would overwrite each other\n", .{name});
+        return error.DuplicateJobName;
+    }
+
+    if (out_dir.len == 0) out_dir = "batch-output";
+    try std.Io.Dir.cwd().createDirPath(io, out_dir);
+
+    var with_meshes = false;
+    for (jobs) |job| with_meshes = with_meshes or job.outputs.contains(.mesh);
+
+    var batch: Batch = .{
+        .allocator = allocator,
+        .io = io,
+        .out_dir = out_dir,
+        .jobs = jobs,
+        .cache = .{ .allocator = allocator, .with_meshes = with_meshes },
+    };
+    defer batch.cache.deinit();
+
+    const threads = parallel.threadCount(jobs.len);
+    print("running {d} jobs on {d} threads\n", .{ jobs.len, threads });
+
+    const start = now(io);
+    parallel.forEach(jobs.len, &batch, runJob);
+    const total_ms = millisSince(io, start);
+
+    const reports = try arena.alloc(JobReport, jobs.len);
+    var failed: usize = 0;
+    for (jobs, reports) |job, *report| {
+        report.* = job.report;
+        if (!job.report.ok) failed += 1;
+    }
+
+    const report = try std.json.Stringify.valueAlloc(arena, .{
+        .threads = threads,
+        .total_ms = total_ms,
+        .failed = failed,
+        .cache = .{
+            .hits = batch.cache.hits.load(.monotonic),
+            .misses = batch.cache.misses.load(.monotonic),
+        },
+        .jobs = reports,
+    }, .{ .whitespace = .indent_2 });
+
+    const report_path = try std.fmt.allocPrint(arena, "{s}/report.json", .{out_dir});
+    try writeFile(io, report_path, report);
+
+    print("processed {d} jobs in {d:.0} ms, {d} failed, report written to {s}\n", .{ jobs.len, total_ms, failed, report_path });
+    if (failed != 0) return error.JobsFailed;
+}
+
+test parseOutputs {
+    const outputs = try parseOutputs("mesh,step");
+    try std.testing.expect(outputs.contains(.mesh));
+    try std.testing.expect(!outputs.contains(.svg));
+    try std.testing.expect(outputs.contains(.step));
+    try std.testing.expectError(error.UnknownOutput, parseOutputs("mesh,obj"));
+}
+
+test duplicateName {
+    var arena_state = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena_state.deinit();
+    const arena = arena_state.allocator();
+
+    var jobs = [_]Job{
+        .{ .recipe = "in/shelf.json", .outputs = .initOne(.mesh), .report = .{ .name = "shelf", .recipe = "in/shelf.json" } },
+        .{ .recipe = "in/desk.json", .outputs = .initOne(.mesh), .report = .{ .name = "desk", .recipe = "in/desk.json" } },
+    };
+    try std.testing.expectEqual(null, try duplicateName(arena, &jobs));
+
+    jobs[1].report.name = "shelf";
+    try std.testing.expectEqualStrings("shelf", (try duplicateName(arena, &jobs)).?);
+}
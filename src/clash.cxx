@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <BOPTools_BoxTree.hxx>
+#include <BRepAlgoAPI_Common.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepGProp.hxx>
+#include <Bnd_Box.hxx>
+#include <Bnd_Tools.hxx>
+#include <GProp_GProps.hxx>
+#include <OSD_Parallel.hxx>
+#include <TopoDS_Shape.hxx>
+
+#include "occ.hxx"
+#include "opaque.hxx"
+
+// interferences below this volume (in mm3) are considered as touching parts
+static const double clashVolumeTolerance = 1e-3;
+
+/**
+ * @brief Computes the volume shared by two solids.
+ * @return The volume of the common part, 0 if the boolean failed.
+ */
+double interferenceVolume(const TopoDS_Shape &s1, const TopoDS_Shape &s2) {
+  BRepAlgoAPI_Common commonOp(s1, s2);
+  commonOp.SetRunParallel(false);
+  // instances are located copies of the same shapes and pairs are checked in
+  // parallel, the boolean must not touch their tolerances or pcurves
+  commonOp.SetNonDestructive(Standard_True);
+  commonOp.Build();
+
+  if (!commonOp.IsDone()) {
+    std::cerr << "Warning: could not compute interference between shapes"
+              << std::endl;
+    return 0;
+  }
+
+  GProp_GProps props;
+  BRepGProp::VolumeProperties(commonOp.Shape(), props);
+  return props.Mass();
+}
+
+extern "C" {
+
+/**
+ * @brief Finds the pairs of shapes that interfere with each other.
+ * Candidate pairs come from a bounding volume hierarchy built over the shapes
+ * bounding boxes, only those are checked with an exact boolean.
+ * @param shapes The located shapes to check.
+ * @param clashes The buffer where the clashing pairs are written, at most
+ * `maxLength` of them.
+ * @return The number of clashes found, which is more than `maxLength` when
+ * the buffer was too small.
+ */
+size_t findClashes(Shape *const *shapes, size_t size, Clash *clashes,
+                   size_t maxLength) {
+  BOPTools_Box3dTree tree;
+  tree.SetSize(static_cast<int>(size));
+
+  for (size_t i = 0; i < size; i++) {
+    Bnd_Box box;
+    BRepBndLib::Add(shapes[i]->shape, box);
+    if (box.IsVoid())
+      continue;
+    tree.Add(static_cast<int>(i), Bnd_Tools::Bnd2BVH(box));
+  }
+  tree.Build();
+
+  BOPTools_Box3dPairSelector selector;
+  selector.SetBVHSets(&tree, &tree);
+  selector.SetSame(Standard_True);
+  selector.Select();
+
+  std::vector<std::pair<int, int>> candidates;
+  for (const auto &pair : selector.Pairs()) {
+    if (pair.ID1 == pair.ID2)
+      continue;
+    candidates.emplace_back(std::min(pair.ID1, pair.ID2),
+                            std::max(pair.ID1, pair.ID2));
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+
+  std::vector<double> volumes(candidates.size(), 0);
+  OSD_Parallel::For(0, static_cast<int>(candidates.size()),
+                    [&](const int i) {
+                      const auto &pair = candidates[i];
+                      volumes[i] =
+                          interferenceVolume(shapes[pair.first]->shape,
+                                             shapes[pair.second]->shape);
+                    });
+
+  size_t found = 0;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (volumes[i] < clashVolumeTolerance)
+      continue;
+
+    if (found < maxLength) {
+      Clash clash;
+      clash.first = candidates[i].first;
+      clash.second = candidates[i].second;
+      clash.volume = volumes[i];
+      clashes[found] = clash;
+    }
+    found++;
+  }
+
+  return found;
+}
+}
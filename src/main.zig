@@ -1,7 +1,15 @@
 const std = @import("std");
 const server = @import("server.zig");
+const batch = @import("batch.zig");
 
 pub fn main(init: std.process.Init) !void {
+    const args = try init.minimal.args.toSlice(init.arena.allocator());
+
+    if (args.len > 1 and std.mem.eql(u8, args[1], "batch")) {
+        try batch.run(init.gpa, init.io, args[2..]);
+        return;
+    }
+
     try server.serve(init.gpa, init.io);
 }
 
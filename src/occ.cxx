@@ -4,6 +4,8 @@
 #include <map>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 // OpenCASCADE Headers
 #include <BRepBuilderAPI_MakeEdge.hxx>
@@ -52,6 +54,7 @@
 #include <Message_MsgFile.hxx>
 
 #include <BRepAlgoAPI_Check.hxx>
+#include <BRepCheck_Analyzer.hxx>
 #include <BRepTools.hxx>
 
 #include <BRep_Builder.hxx>
@@ -150,13 +153,115 @@ std::tuple<int, int, int> getPointKey(const gp_Pnt &p) {
   return std::make_tuple(keyX, keyY, keyZ);
 }
 
+// points stored as separate coordinate arrays, moved for each located copy
+// with a single 3x4 transform
+struct Points {
+  std::vector<double> x, y, z;
+
+  size_t size() const { return x.size(); }
+
+  void push_back(const gp_Pnt &p) {
+    x.push_back(p.X());
+    y.push_back(p.Y());
+    z.push_back(p.Z());
+  }
+};
+
+// nodes and 1-based triangles of a face, in the coordinates of its TShape
+struct PackedFace {
+  Points nodes;
+  std::vector<int> triangles;
+};
+
+static void transformPoints(const TopLoc_Location &location, const Points &in,
+                            Points &out) {
+  const gp_Trsf trsf = location.Transformation();
+  double m[3][4];
+  for (int r = 0; r < 3; r++)
+    for (int c = 0; c < 4; c++)
+      m[r][c] = trsf.Value(r + 1, c + 1);
+
+  const size_t n = in.size();
+  out.x.resize(n);
+  out.y.resize(n);
+  out.z.resize(n);
+
+  const double *x = in.x.data(), *y = in.y.data(), *z = in.z.data();
+  double *__restrict ox = out.x.data();
+  double *__restrict oy = out.y.data();
+  double *__restrict oz = out.z.data();
+  for (size_t i = 0; i < n; i++) {
+    ox[i] = m[0][0] * x[i] + m[0][1] * y[i] + m[0][2] * z[i] + m[0][3];
+    oy[i] = m[1][0] * x[i] + m[1][1] * y[i] + m[1][2] * z[i] + m[1][3];
+    oz[i] = m[2][0] * x[i] + m[2][1] * y[i] + m[2][2] * z[i] + m[2][3];
+  }
+}
+
+// points of `in` moved by `location`, without copying when there is nothing
+// to move
+static const Points &locatePoints(const TopLoc_Location &location,
+                                  const Points &in, Points &buffer) {
+  if (location.IsIdentity())
+    return in;
+  transformPoints(location, in, buffer);
+  return buffer;
+}
+
+static PackedFace packFace(const TopoDS_Face &face) {
+  PackedFace packed;
+  TopLoc_Location location;
+  Handle(Poly_Triangulation) triangulation =
+      BRep_Tool::Triangulation(face, location);
+  if (triangulation.IsNull())
+    return packed;
+
+  Points nodes;
+  for (int i = 1; i <= triangulation->NbNodes(); ++i)
+    nodes.push_back(triangulation->Node(i));
+  packed.nodes = locatePoints(location, nodes, packed.nodes);
+
+  packed.triangles.reserve(3 * triangulation->NbTriangles());
+  for (int i = 1; i <= triangulation->NbTriangles(); ++i) {
+    int n1, n2, n3;
+    triangulation->Triangle(i).Get(n1, n2, n3);
+    packed.triangles.insert(packed.triangles.end(), {n1, n2, n3});
+  }
+  return packed;
+}
+
+static Points discretizeEdge(const TopoDS_Edge &edge, double deflection) {
+  Points points;
+
+  double first, last;
+  Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, first, last);
+  if (curve.IsNull())
+    return points;
+
+  BRepAdaptor_Curve adapt(edge);
+
+  // Discretize edge with a deflection-based algorithm
+  GCPnts_QuasiUniformDeflection discretizer(adapt, deflection);
+  if (!discretizer.IsDone())
+    return points;
+
+  for (int i = 1; i <= discretizer.NbPoints(); ++i)
+    points.push_back(discretizer.Value(i));
+  return points;
+}
+
 /**
  * @brief Meshes a given solid shape and writes the mesh data to an OBJ file.
+ * Located copies of the same faces and edges, as made by `locate` steps and
+ * patterns, are meshed and discretized once and only moved for each copy.
  * @param aShape The solid shape to be meshed.
+ * @param params The deflections used to mesh faces and outlines.
  * @param buffer The buffer to write to.
+ * @param capacity The size of the buffer.
+ * @return The number of bytes written, -1 for a null shape and -2 when the
+ * mesh does not fit in the buffer.
  */
-int writeSolidToObj(const TopoDS_Shape &shape, char *buffer,
-                    bool dumpOutlines = true) {
+int writeSolidToObj(const TopoDS_Shape &shape, const MeshParameters &params,
+                    char *buffer, size_t capacity, bool dumpOutlines = true) {
   std::ostringstream oss;
 
   if (shape.IsNull()) {
@@ -164,10 +269,37 @@ int writeSolidToObj(const TopoDS_Shape &shape, char *buffer,
     return -1;
   }
 
-  buffer[1024 * 16 + 10] = '4';
-  // Use a sensible deflection value (e.g., 0.1) for a good balance of detail
-  // and file size.
-  BRepMesh_IncrementalMesh aMesh(shape, 1, false, 0.5);
+  // every occurrence of a face, along with the index of its TShape
+  std::vector<TopoDS_Face> faces;
+  std::vector<size_t> faceShapes;
+  std::unordered_map<const TopoDS_TShape *, size_t> uniqueIndices;
+
+  BRep_Builder builder;
+  TopoDS_Compound uniqueFaces;
+  builder.MakeCompound(uniqueFaces);
+  std::vector<TopoDS_Face> unlocatedFaces;
+
+  for (TopExp_Explorer exp(shape, TopAbs_FACE); exp.More(); exp.Next()) {
+    const TopoDS_Face &face = TopoDS::Face(exp.Current());
+    const auto [it, inserted] =
+        uniqueIndices.emplace(face.TShape().get(), unlocatedFaces.size());
+    if (inserted) {
+      unlocatedFaces.push_back(TopoDS::Face(face.Located(TopLoc_Location())));
+      builder.Add(uniqueFaces, unlocatedFaces.back());
+    }
+    faces.push_back(face);
+    faceShapes.push_back(it->second);
+  }
+
+  // The triangulation is stored on the TShape, so meshing the unique faces
+  // meshes every copy.
+  BRepMesh_IncrementalMesh aMesh(uniqueFaces, params.linearDeflection, false,
+                                 params.angularDeflection);
+
+  std::vector<PackedFace> packedFaces;
+  packedFaces.reserve(unlocatedFaces.size());
+  for (const auto &face : unlocatedFaces)
+    packedFaces.push_back(packFace(face));
 
   oss << "# Open CASCADE Technology generated OBJ file" << std::endl;
   oss << "g occt_solid" << std::endl;
@@ -177,53 +309,55 @@ int writeSolidToObj(const TopoDS_Shape &shape, char *buffer,
 
   // Keep track of the vertex index count as OBJ face indices are 1-based.
   int vertexCount = 1;
-  TopExp_Explorer anExpFace(shape, TopAbs_FACE);
-  for (; anExpFace.More(); anExpFace.Next()) {
-    const TopoDS_Face &aFace = TopoDS::Face(anExpFace.Current());
-    TopLoc_Location aLocation;
-    Handle(Poly_Triangulation) aTriangulation =
-        BRep_Tool::Triangulation(aFace, aLocation);
+  std::vector<int> faceOffsets(faces.size(), 0);
+  Points located;
 
-    if (!aTriangulation.IsNull()) {
-      const auto nb_nodes = aTriangulation->NbNodes();
-      for (int i = 1; i <= nb_nodes; ++i) {
-        gp_Pnt node = aTriangulation->Node(i);
+  for (size_t f = 0; f < faces.size(); f++) {
+    const PackedFace &packed = packedFaces[faceShapes[f]];
+    if (packed.nodes.size() == 0)
+      continue;
 
-        if (!aLocation.IsIdentity()) {
-          node.Transform(aLocation.Transformation());
-        }
+    const Points &nodes =
+        locatePoints(faces[f].Location(), packed.nodes, located);
 
-        const auto key = getPointKey(node);
-        vertexMap[key] = vertexCount++;
+    faceOffsets[f] = vertexCount;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const gp_Pnt node(nodes.x[i], nodes.y[i], nodes.z[i]);
 
-        oss << "v " << node.X() << " " << node.Y() << " " << node.Z()
-            << std::endl;
-      }
+      const auto key = getPointKey(node);
+      vertexMap[key] = vertexCount++;
+
+      oss << "v " << node.X() << " " << node.Y() << " " << node.Z()
+          << std::endl;
     }
   }
 
   std::ostringstream linesStream;
+  std::unordered_map<const TopoDS_TShape *, Points> edgePoints;
 
   for (TopExp_Explorer exp(shape, TopAbs_EDGE); exp.More(); exp.Next()) {
-    TopoDS_Edge edge = TopoDS::Edge(exp.Current());
-
-    // Get 3D curve of the edge
-    double first, last;
-    Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, first, last);
-    if (curve.IsNull())
+    const TopoDS_Edge &edge = TopoDS::Edge(exp.Current());
+
+    auto cached = edgePoints.find(edge.TShape().get());
+    if (cached == edgePoints.end()) {
+      const TopoDS_Edge unlocated =
+          TopoDS::Edge(edge.Located(TopLoc_Location()));
+      cached =
+          edgePoints
+              .emplace(edge.TShape().get(),
+                       discretizeEdge(unlocated, params.outlineDeflection))
+              .first;
+    }
+    if (cached->second.size() == 0)
       continue;
 
-    BRepAdaptor_Curve adapt(edge);
-
-    // Discretize edge with a deflection-based algorithm
-    GCPnts_QuasiUniformDeflection discretizer(adapt, 0.01); // tolerance = 0.01
-    if (!discretizer.IsDone())
-      continue;
+    const Points &points =
+        locatePoints(edge.Location(), cached->second, located);
 
     linesStream << "l";
 
-    for (int i = 1; i <= discretizer.NbPoints(); ++i) {
-      gp_Pnt p = discretizer.Value(i);
+    for (size_t i = 0; i < points.size(); ++i) {
+      const gp_Pnt p(points.x[i], points.y[i], points.z[i]);
 
       const auto key = getPointKey(p);
       auto it = vertexMap.find(key);
@@ -245,29 +379,16 @@ int writeSolidToObj(const TopoDS_Shape &shape, char *buffer,
   }
 
   // This loop is separate to ensure all vertices are defined before the faces.
-  int currentVertexOffset = 1;
-  anExpFace.Init(shape, TopAbs_FACE);
-
-  for (; anExpFace.More(); anExpFace.Next()) {
-    const TopoDS_Face &aFace = TopoDS::Face(anExpFace.Current());
-    TopLoc_Location aLocation;
-    Handle(Poly_Triangulation) aTriangulation =
-        BRep_Tool::Triangulation(aFace, aLocation);
-
-    if (!aTriangulation.IsNull()) {
-      const auto nb_triangles = aTriangulation->NbTriangles();
-      for (int i = 1; i <= nb_triangles; ++i) {
-        Poly_Triangle tri = aTriangulation->Triangle(i);
-        int n1, n2, n3;
-        tri.Get(n1, n2, n3);
-        // OBJ face indices are 1-based and relative to the start of the file.
-        // We add the offset from previous faces to get the correct global
-        // index.
-        oss << "f " << (n1 + currentVertexOffset - 1) << " "
-            << (n2 + currentVertexOffset - 1) << " "
-            << (n3 + currentVertexOffset - 1) << std::endl;
-      }
-      currentVertexOffset += aTriangulation->NbNodes();
+  for (size_t f = 0; f < faces.size(); f++) {
+    const PackedFace &packed = packedFaces[faceShapes[f]];
+    // OBJ face indices are 1-based and relative to the start of the file.
+    // We add the offset of the face nodes to get the correct global index.
+    const int offset = faceOffsets[f] - 1;
+    const std::vector<int> &triangles = packed.triangles;
+    for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+      oss << "f " << (triangles[i] + offset) << " "
+          << (triangles[i + 1] + offset) << " " << (triangles[i + 2] + offset)
+          << std::endl;
     }
   }
 
@@ -280,11 +401,111 @@ int writeSolidToObj(const TopoDS_Shape &shape, char *buffer,
 
   std::cout << "Attempting to write " << length << " bytes to buffer"
             << std::endl;
+  if (length > capacity) {
+    std::cerr << "Error: mesh of " << length << " bytes does not fit in "
+              << capacity << " bytes." << std::endl;
+    return -2;
+  }
   str.copy(buffer, length);
   std::cout << "Successfully wrote mesh to buffer " << std::endl;
   return length;
 }
 
+/**
+ * @brief Reference for writeSolidToObj: meshes the located solid and reads
+ * the triangulation of every face occurrence on its own, the way meshes were
+ * written before copies were shared. Only used to check that both write the
+ * same OBJ.
+ */
+static int writeSolidToObjPerFace(const TopoDS_Shape &shape,
+                                  const MeshParameters &params, char *buffer,
+                                  size_t capacity) {
+  if (shape.IsNull())
+    return -1;
+
+  BRepMesh_IncrementalMesh aMesh(shape, params.linearDeflection, false,
+                                 params.angularDeflection);
+
+  std::ostringstream oss;
+  oss << "# Open CASCADE Technology generated OBJ file" << std::endl;
+  oss << "g occt_solid" << std::endl;
+
+  std::map<std::tuple<int, int, int>, int> vertexMap;
+  int vertexCount = 1;
+
+  for (TopExp_Explorer exp(shape, TopAbs_FACE); exp.More(); exp.Next()) {
+    TopLoc_Location aLocation;
+    Handle(Poly_Triangulation) aTriangulation =
+        BRep_Tool::Triangulation(TopoDS::Face(exp.Current()), aLocation);
+    if (aTriangulation.IsNull())
+      continue;
+
+    for (int i = 1; i <= aTriangulation->NbNodes(); ++i) {
+      gp_Pnt node = aTriangulation->Node(i);
+      if (!aLocation.IsIdentity())
+        node.Transform(aLocation.Transformation());
+
+      vertexMap[getPointKey(node)] = vertexCount++;
+      oss << "v " << node.X() << " " << node.Y() << " " << node.Z()
+          << std::endl;
+    }
+  }
+
+  std::ostringstream linesStream;
+  for (TopExp_Explorer exp(shape, TopAbs_EDGE); exp.More(); exp.Next()) {
+    const TopoDS_Edge &edge = TopoDS::Edge(exp.Current());
+
+    double first, last;
+    if (BRep_Tool::Curve(edge, first, last).IsNull())
+      continue;
+
+    BRepAdaptor_Curve adapt(edge);
+    GCPnts_QuasiUniformDeflection discretizer(adapt, params.outlineDeflection);
+    if (!discretizer.IsDone())
+      continue;
+
+    linesStream << "l";
+    for (int i = 1; i <= discretizer.NbPoints(); ++i) {
+      gp_Pnt p = discretizer.Value(i);
+      const auto key = getPointKey(p);
+      auto it = vertexMap.find(key);
+      if (it == vertexMap.end()) {
+        linesStream << " " << vertexCount;
+        vertexMap[key] = vertexCount++;
+        oss << "v " << p.X() << " " << p.Y() << " " << p.Z() << std::endl;
+      } else {
+        linesStream << " " << it->second;
+      }
+    }
+    linesStream << "\n";
+  }
+
+  int currentVertexOffset = 1;
+  for (TopExp_Explorer exp(shape, TopAbs_FACE); exp.More(); exp.Next()) {
+    TopLoc_Location aLocation;
+    Handle(Poly_Triangulation) aTriangulation =
+        BRep_Tool::Triangulation(TopoDS::Face(exp.Current()), aLocation);
+    if (aTriangulation.IsNull())
+      continue;
+
+    for (int i = 1; i <= aTriangulation->NbTriangles(); ++i) {
+      int n1, n2, n3;
+      aTriangulation->Triangle(i).Get(n1, n2, n3);
+      oss << "f " << (n1 + currentVertexOffset - 1) << " "
+          << (n2 + currentVertexOffset - 1) << " "
+          << (n3 + currentVertexOffset - 1) << std::endl;
+    }
+    currentVertexOffset += aTriangulation->NbNodes();
+  }
+  oss << linesStream.str();
+
+  const std::string str = oss.str();
+  if (str.size() > capacity)
+    return -2;
+  str.copy(buffer, str.size());
+  return str.size();
+}
+
 bool WriteCompoundToSTEPString2(const TopoDS_Compound &compound,
                                 std::string &stepString) {
   // Create STEP writer
@@ -530,15 +751,7 @@ TopoDS_Face makeFaceFromSegments(const PathSegment *segments, size_t size) {
   return face;
 }
 
-extern "C" {
-
-Shape *extrudePathWithHoles(const PathSegment *segments, size_t size,
-                            double thickness) {
-  TopoDS_Face face = makeFaceFromSegments(segments, size);
-  if (!face.IsNull()) {
-    std::cout << "Successfully created TopoDS_Face from the wire." << std::endl;
-  }
-
+Shape *extrudeFace(const TopoDS_Face &face, double thickness) {
   gp_Vec aVector(0, 0, thickness);
 
   BRepPrimAPI_MakePrism aPrismMaker(face, aVector);
@@ -557,6 +770,38 @@ Shape *extrudePathWithHoles(const PathSegment *segments, size_t size,
   return result;
 }
 
+extern "C" {
+
+Shape *extrudePathWithHoles(const PathSegment *segments, size_t size,
+                            double thickness) {
+  TopoDS_Face face = makeFaceFromSegments(segments, size);
+  if (!face.IsNull()) {
+    std::cout << "Successfully created TopoDS_Face from the wire." << std::endl;
+  }
+
+  return extrudeFace(face, thickness);
+}
+
+/**
+ * @brief Same as extrudePathWithHoles but gives up when the face is not
+ * valid, typically when an inside crosses the outside or another inside.
+ * @return The extruded shape or null.
+ */
+Shape *tryExtrudePathWithHoles(const PathSegment *segments, size_t size,
+                               double thickness) {
+  TopoDS_Face face = makeFaceFromSegments(segments, size);
+  if (face.IsNull())
+    return nullptr;
+
+  BRepCheck_Analyzer analyzer(face);
+  if (!analyzer.IsValid()) {
+    std::cout << "Face with folded cutouts is not valid" << std::endl;
+    return nullptr;
+  }
+
+  return extrudeFace(face, thickness);
+}
+
 Shape *revolvePath(const PathSegment *segments, size_t size, Transform *trsf,
                    double rotation) {
   TopoDS_Wire wire = createWireFromPathSegments(segments, size);
@@ -637,6 +882,16 @@ Shape *applyShapeLocationTransform(Shape *shape, Transform *trsf) {
   return result;
 }
 
+Shape *locateShape(Shape *shape, Transform *trsf) {
+  if (!shape || !trsf)
+    return shape;
+
+  Shape *result = new Shape;
+  result->shape = shape->shape.Located(TopLoc_Location(trsf->trsf));
+
+  return result;
+}
+
 Shape *fuseShapes(Shape *shape1, Shape *shape2) {
   if (!shape1 || !shape2) {
     std::cout << "couldn't fuse shapes as one of the arguments is null"
@@ -693,12 +948,19 @@ Shape *cutShape(Shape *toCut, Shape *cutout) {
   return result;
 }
 
-int writeToOBJ(Shape *shape, char *buffer) {
-  const auto out_length = writeSolidToObj(shape->shape, buffer);
+int writeToOBJ(Shape *shape, const MeshParameters *params, char *buffer,
+               size_t capacity) {
+  const auto out_length =
+      writeSolidToObj(shape->shape, *params, buffer, capacity);
   return out_length;
 }
 
-void saveToSTEP(Compound *cmp, const char *filepath) {
+int writeToOBJPerFace(Shape *shape, const MeshParameters *params, char *buffer,
+                      size_t capacity) {
+  return writeSolidToObjPerFace(shape->shape, *params, buffer, capacity);
+}
+
+int saveToSTEP(Compound *cmp, const char *filepath) {
   TopoDS_Compound compound = cmp->compound;
 
   STEPControl_Writer writer;
@@ -710,14 +972,15 @@ void saveToSTEP(Compound *cmp, const char *filepath) {
   if (status != IFSelect_RetDone) {
     std::cerr << "Error: Failed to transfer compound to STEP writer"
               << std::endl;
-    return;
+    return -1;
   }
 
   status = writer.Write(filepath);
   if (status != IFSelect_RetDone) {
     std::cerr << "Error: Failed to write STEP file" << std::endl;
-    return;
+    return -1;
   }
+  return 0;
 }
 
 Compound *makeCompound() { return new Compound; }
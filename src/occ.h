@@ -1,5 +1,5 @@
-#include "occ.hxx"
 #include "stddef.h"
+#include "occ.hxx"
 
 typedef struct Shape Shape;
 typedef struct Compound Compound;
@@ -7,14 +7,20 @@ typedef struct Transform Transform;
 
 Shape *extrudePathWithHoles(const struct PathSegment *segments, size_t size,
                             double thickness);
+Shape *tryExtrudePathWithHoles(const struct PathSegment *segments, size_t size,
+                               double thickness);
 Shape *revolvePath(const struct PathSegment *segments, size_t size,
                    Transform *trsf, double rotation);
 Shape *sweepPathAlong3DPath(const struct PathSegment *segments,
                             size_t directrixSize, size_t size);
 void freeShape(Shape *shape);
 
-int writeToOBJ(Shape *shape, char *buffer);
-void saveToSTEP(Compound *cmp, const char *filepath);
+int writeToOBJ(Shape *shape, const struct MeshParameters *params, char *buffer,
+               size_t capacity);
+// writes the same OBJ as writeToOBJ without sharing located copies, for tests
+int writeToOBJPerFace(Shape *shape, const struct MeshParameters *params,
+                      char *buffer, size_t capacity);
+int saveToSTEP(Compound *cmp, const char *filepath);
 
 Compound *makeCompound();
 void freeCompound(Compound *cmp);
@@ -25,12 +31,29 @@ Transform *makeTransform(const double m[16]);
 void freeTransform(Transform *trsf);
 
 Shape *applyShapeLocationTransform(Shape *shape, Transform *trsf);
+Shape *locateShape(Shape *shape, Transform *trsf);
 
 Shape *fuseShapes(Shape *shape1, Shape *shape2);
 
 Shape *intersectShapes(Shape *shape1, Shape *shape2);
 
 Shape *cutShape(Shape *toCut, Shape *cutout);
+Shape *cutShapes(Shape *toCut, Shape *const *cutouts, size_t count);
+
+Shape *makeBox(double dx, double dy, double dz);
+Shape *makeCylinder(double radius, double height);
+Shape *makeCountersunkHole(double radius, double depth, double headRadius,
+                           double angle);
+Shape *patternShape(Shape *shape, const double *transforms, size_t count);
 
 size_t shapeToSVGSegments(const Compound *compound, struct PathSegment *segments,
                           size_t maxLength);
+
+size_t sectionToSVGSegments(const Shape *shape, const Transform *plane,
+                            struct PathSegment *segments, size_t maxLength);
+
+void computeShapeProperties(const Shape *shape,
+                            struct ShapeProperties *properties);
+
+size_t findClashes(Shape *const *shapes, size_t size, struct Clash *clashes,
+                   size_t maxLength);
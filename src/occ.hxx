@@ -9,3 +9,31 @@ struct PathSegment {
   char sweep;
 };
 
+struct MeshParameters {
+  // deflections of the face triangulation, linear in mm and angular in rad
+  double linearDeflection;
+  double angularDeflection;
+  // deflection of the edges written as outlines, in mm
+  double outlineDeflection;
+};
+
+struct Clash {
+  size_t first;
+  size_t second;
+  double volume;
+};
+
+struct ShapeProperties {
+  // xmin, ymin, zmin, xmax, ymax, zmax
+  double aabb[6];
+  double obbCenter[3];
+  // x, y and z directions of the box, one after the other
+  double obbAxes[9];
+  double obbHalfSizes[3];
+  double volume;
+  double area;
+  double centroid[3];
+  size_t nbSolids;
+  size_t nbFaces;
+  size_t nbEdges;
+};
@@ -4,12 +4,17 @@ pub const Shape = occ.Shape;
 pub const Compound = occ.Compound;
 pub const Transform = occ.Transform;
 pub const PathSegment = occ.PathSegment;
+pub const Clash = occ.Clash;
+pub const MeshParameters = occ.MeshParameters;
+pub const ShapeProperties = occ.ShapeProperties;
 
 pub const extrudePathWithHoles = occ.extrudePathWithHoles;
+pub const tryExtrudePathWithHoles = occ.tryExtrudePathWithHoles;
 pub const revolvePath = occ.revolvePath;
 pub const sweepPathAlong3DPath = occ.sweepPathAlong3DPath;
 pub const freeShape = occ.freeShape;
 pub const writeToOBJ = occ.writeToOBJ;
+pub const writeToOBJPerFace = occ.writeToOBJPerFace;
 pub const saveToSTEP = occ.saveToSTEP;
 pub const makeCompound = occ.makeCompound;
 pub const freeCompound = occ.freeCompound;
@@ -17,7 +22,16 @@ pub const addShapeToCompound = occ.addShapeToCompound;
 pub const makeTransform = occ.makeTransform;
 pub const freeTransform = occ.freeTransform;
 pub const applyShapeLocationTransform = occ.applyShapeLocationTransform;
+pub const locateShape = occ.locateShape;
 pub const fuseShapes = occ.fuseShapes;
 pub const intersectShapes = occ.intersectShapes;
 pub const cutShape = occ.cutShape;
+pub const cutShapes = occ.cutShapes;
+pub const makeBox = occ.makeBox;
+pub const makeCylinder = occ.makeCylinder;
+pub const makeCountersunkHole = occ.makeCountersunkHole;
+pub const patternShape = occ.patternShape;
 pub const shapeToSVGSegments = occ.shapeToSVGSegments;
+pub const sectionToSVGSegments = occ.sectionToSVGSegments;
+pub const findClashes = occ.findClashes;
+pub const computeShapeProperties = occ.computeShapeProperties;
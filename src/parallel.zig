@@ -0,0 +1,61 @@
+const std = @import("std");
+
+const max_threads = 64;
+
+pub fn threadCount(count: usize) usize {
+    const cpus = std.Thread.getCpuCount() catch 1;
+    return @max(1, @min(count, cpus, max_threads));
+}
+
+/// Calls `func(context, i)` for every `i` in `0..count`, spreading the items
+/// over as many threads as there are cores. Threads take the next item from a
+/// shared atomic counter, there are no per-thread queues and no stealing. The
+/// calling thread takes part in the work and the function returns once every
+/// item is processed. Errors are logged and do not stop the other items.
+pub fn forEach(count: usize, context: anytype, comptime func: fn (@TypeOf(context), usize) anyerror!void) void {
+    const Context = @TypeOf(context);
+    const Worker = struct {
+        fn run(ctx: Context, next: *std.atomic.Value(usize), total: usize) void {
+            while (true) {
+                const i = next.fetchAdd(1, .monotonic);
+                if (i >= total) return;
+                func(ctx, i) catch |err| {
+                    std.log.err("parallel item {d} failed: {s}", .{ i, @errorName(err) });
+                };
+            }
+        }
+    };
+
+    var next = std.atomic.Value(usize).init(0);
+    var threads: [max_threads]std.Thread = undefined;
+    var spawned: usize = 0;
+
+    for (1..threadCount(count)) |_| {
+        threads[spawned] = std.Thread.spawn(.{}, Worker.run, .{ context, &next, count }) catch |err| {
+            std.log.err("unable to spawn worker: {s}", .{@errorName(err)});
+            break;
+        };
+        spawned += 1;
+    }
+
+    Worker.run(context, &next, count);
+    for (threads[0..spawned]) |thread| thread.join();
+}
+
+test forEach {
+    const Sum = struct {
+        values: []std.atomic.Value(usize),
+
+        fn square(self: *const @This(), i: usize) anyerror!void {
+            self.values[i].store(i * i, .monotonic);
+        }
+    };
+
+    var values: [100]std.atomic.Value(usize) = undefined;
+    for (&values) |*v| v.* = .init(0);
+    const sum: Sum = .{ .values = &values };
+
+    forEach(values.len, &sum, Sum.square);
+
+    for (values, 0..) |v, i| try std.testing.expectEqual(i * i, v.load(.monotonic));
+}
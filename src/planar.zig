@@ -0,0 +1,301 @@
+const std = @import("std");
+const occ = @import("occ.zig");
+const recipe = @import("recipe.zig");
+const Allocator = std.mem.Allocator;
+
+const PathSegment = occ.PathSegment;
+const Transform = recipe.Transform;
+
+const tolerance = 1e-6;
+
+/// A prism built from a planar outline, as produced by an extrusion step.
+/// The outline lives in the XY plane of `frame` and is extruded by `length`
+/// along its Z axis.
+pub const Profile = struct {
+    segments: []const PathSegment,
+    length: f64,
+    frame: Transform,
+
+    fn nbWires(self: Profile) usize {
+        var count: usize = 0;
+        for (self.segments) |seg| {
+            if (seg.command == 'Z') count += 1;
+        }
+        return count;
+    }
+
+    pub fn located(self: Profile, placement: ?Transform) Profile {
+        var result = self;
+        if (placement) |p| result.frame = multiply(self.frame, p);
+        return result;
+    }
+
+    /// Same profile moved by a transform expressed in the frame it is
+    /// located in, as for the copies of a pattern.
+    pub fn moved(self: Profile, transform: Transform) Profile {
+        var result = self;
+        result.frame = multiply(transform, self.frame);
+        return result;
+    }
+};
+
+/// Copies of a prism made by a pattern step, `frame` locates the whole
+/// pattern.
+pub const Pattern = struct {
+    profile: Profile,
+    copies: []const Transform,
+    frame: Transform = recipe.identity,
+
+    pub fn located(self: Pattern, placement: ?Transform) Pattern {
+        var result = self;
+        if (placement) |p| result.frame = multiply(self.frame, p);
+        return result;
+    }
+
+    pub fn copy(self: Pattern, i: usize) Profile {
+        return self.profile.moved(self.copies[i]).moved(self.frame);
+    }
+};
+
+/// Outline of `makeBox`, a `dx` by `dy` rectangle with a corner at the origin.
+pub fn rectangle(allocator: Allocator, dx: f64, dy: f64) ![]PathSegment {
+    const x: f32 = @floatCast(dx);
+    const y: f32 = @floatCast(dy);
+    return allocator.dupe(PathSegment, &.{
+        segment('M', 0, 0),
+        segment('L', 0, y),
+        segment('L', x, y),
+        segment('L', x, 0),
+        segment('Z', 0, 0),
+    });
+}
+
+/// Outline of `makeCylinder`, a circle centered on the origin drawn as two
+/// arcs with the same rotation as `rectangle`.
+pub fn circle(allocator: Allocator, radius: f64) ![]PathSegment {
+    const r: f32 = @floatCast(radius);
+    var arc = segment('A', -r, 0);
+    arc.radius = r;
+    arc.radius2 = r;
+    var closing = arc;
+    closing.x = r;
+    return allocator.dupe(PathSegment, &.{ segment('M', r, 0), arc, closing, segment('Z', 0, 0) });
+}
+
+/// Transforms of the copies of a pattern step, the first one being the
+/// identity. They apply in the frame the patterned shape is located in.
+pub fn patternCopies(allocator: Allocator, step: recipe.Step) ![]Transform {
+    const copies = try allocator.alloc(Transform, step.count);
+    errdefer allocator.free(copies);
+
+    switch (step.operation) {
+        .linear_pattern => for (copies, 0..) |*copy, i| {
+            const n: f64 = @floatFromInt(i);
+            copy.* = recipe.identity;
+            for (0..3) |k| copy[12 + k] = n * step.size[k];
+        },
+        .circular_pattern => {
+            if (!isRigid(step.axis)) return error.InvalidAxis;
+            const to_axis = invertRigid(step.axis);
+            for (copies, 0..) |*copy, i| {
+                const angle = @as(f64, @floatFromInt(i)) * step.rotation;
+                var rotation = recipe.identity;
+                rotation[0] = @cos(angle);
+                rotation[1] = @sin(angle);
+                rotation[4] = -@sin(angle);
+                rotation[5] = @cos(angle);
+                copy.* = multiply(step.axis, multiply(rotation, to_axis));
+            }
+        },
+        else => unreachable,
+    }
+    return copies;
+}
+
+/// Product of two column-major matrices, same composition as
+/// `applyShapeLocationTransform`.
+pub fn multiply(a: Transform, b: Transform) Transform {
+    var result: Transform = undefined;
+    for (0..4) |c| {
+        for (0..4) |r| {
+            var sum: f64 = 0;
+            for (0..4) |k| sum += a[k * 4 + r] * b[c * 4 + k];
+            result[c * 4 + r] = sum;
+        }
+    }
+    return result;
+}
+
+fn isRigid(m: Transform) bool {
+    for (0..3) |i| {
+        for (0..3) |j| {
+            var dot: f64 = 0;
+            for (0..3) |k| dot += m[i * 4 + k] * m[j * 4 + k];
+            const expected: f64 = if (i == j) 1 else 0;
+            if (@abs(dot - expected) > tolerance) return false;
+        }
+    }
+    return true;
+}
+
+/// Inverse of a rigid transform (rotation, possibly mirrored, and translation).
+fn invertRigid(m: Transform) Transform {
+    var result = recipe.identity;
+    for (0..3) |c| {
+        for (0..3) |r| result[c * 4 + r] = m[r * 4 + c];
+    }
+    for (0..3) |r| {
+        var sum: f64 = 0;
+        for (0..3) |k| sum += result[k * 4 + r] * m[12 + k];
+        result[12 + r] = -sum;
+    }
+    return result;
+}
+
+/// Appends the path reversed, assumes a single closed subpath.
+fn appendReversed(allocator: Allocator, out: *std.ArrayList(PathSegment), path: []const PathSegment) !void {
+    const first = path[0];
+    const last_index = path.len - 2; // last segment before the 'Z'
+    const last = path[last_index];
+
+    try out.append(allocator, first);
+    if (last.x != first.x or last.y != first.y) {
+        var line = first;
+        line.command = 'L';
+        line.x = last.x;
+        line.y = last.y;
+        try out.append(allocator, line);
+    }
+
+    var i = last_index;
+    while (i > 0) : (i -= 1) {
+        var seg = path[i];
+        seg.x = path[i - 1].x;
+        seg.y = path[i - 1].y;
+        if (seg.command == 'A') seg.sweep = if (seg.sweep == 0) 1 else 0;
+        try out.append(allocator, seg);
+    }
+
+    try out.append(allocator, path[path.len - 1]);
+}
+
+/// Tries to express `cutout` as an inside of `base`, which is possible when
+/// the cutout is a single outline extruded perpendicularly to the base plane
+/// and goes through the whole base thickness. On success the outline is
+/// appended to `out` in the base coordinates.
+pub fn foldCutout(allocator: Allocator, out: *std.ArrayList(PathSegment), base: Profile, cutout: Profile) !bool {
+    if (cutout.nbWires() != 1 or cutout.segments.len < 3) return false;
+    if (!isRigid(base.frame) or !isRigid(cutout.frame)) return false;
+
+    const rel = multiply(invertRigid(base.frame), cutout.frame);
+
+    // extrusion directions must be parallel
+    if (@abs(rel[8]) > tolerance or @abs(rel[9]) > tolerance) return false;
+    if (@abs(@abs(rel[10]) - 1) > tolerance) return false;
+
+    // and the cutout must go through the base
+    const z1 = rel[14];
+    const z2 = rel[14] + rel[10] * cutout.length;
+    const base_min = @min(0, base.length);
+    const base_max = @max(0, base.length);
+    if (@min(z1, z2) > base_min + tolerance or @max(z1, z2) < base_max - tolerance) return false;
+
+    var transformed = try allocator.alloc(PathSegment, cutout.segments.len);
+    defer allocator.free(transformed);
+
+    const mirrored = rel[0] * rel[5] - rel[4] * rel[1] < 0;
+    for (cutout.segments, 0..) |seg, i| {
+        transformed[i] = seg;
+        if (seg.command == 'Z') continue;
+
+        const x: f64 = seg.x;
+        const y: f64 = seg.y;
+        transformed[i].x = @floatCast(rel[0] * x + rel[4] * y + rel[12]);
+        transformed[i].y = @floatCast(rel[1] * x + rel[5] * y + rel[13]);
+        if (mirrored and seg.command == 'A') transformed[i].sweep = if (seg.sweep == 0) 1 else 0;
+    }
+
+    // a mirror flips the rotation direction, insides have to keep the one
+    // of the outside they come from
+    if (mirrored) {
+        try appendReversed(allocator, out, transformed);
+    } else {
+        try out.appendSlice(allocator, transformed);
+    }
+    return true;
+}
+
+fn segment(command: u8, x: f32, y: f32) PathSegment {
+    return .{ .command = command, .x = x, .y = y, .radius = 0, .sweep = 0 };
+}
+
+test patternCopies {
+    const allocator = std.testing.allocator;
+
+    const row = try patternCopies(allocator, .{ .operation = .linear_pattern, .count = 3, .size = .{ 32, 0, 0 } });
+    defer allocator.free(row);
+    try std.testing.expectEqual(3, row.len);
+    try std.testing.expectEqualDeep(recipe.identity, row[0]);
+    try std.testing.expectEqual(64, row[2][12]);
+
+    // quarter turns around a vertical axis going through (10, 0)
+    var axis = recipe.identity;
+    axis[12] = 10;
+    const ring = try patternCopies(allocator, .{ .operation = .circular_pattern, .count = 4, .axis = axis, .rotation = std.math.pi / 2.0 });
+    defer allocator.free(ring);
+    try std.testing.expectApproxEqAbs(10, ring[1][12], tolerance);
+    try std.testing.expectApproxEqAbs(-10, ring[1][13], tolerance);
+    try std.testing.expectApproxEqAbs(20, ring[2][12], tolerance);
+}
+
+test "folds perpendicular through cuts" {
+    const allocator = std.testing.allocator;
+
+    const square = [_]PathSegment{
+        segment('M', 0, 0),
+        segment('L', 0, 10),
+        segment('L', 10, 10),
+        segment('L', 10, 0),
+        segment('Z', 0, 0),
+    };
+    const base: Profile = .{ .segments = &square, .length = 15, .frame = recipe.identity };
+
+    var out: std.ArrayList(PathSegment) = .empty;
+    defer out.deinit(allocator);
+
+    // translated and going through from below
+    var frame = recipe.identity;
+    frame[12] = 20;
+    frame[14] = -5;
+    const through: Profile = .{ .segments = &square, .length = 30, .frame = frame };
+    try std.testing.expect(try foldCutout(allocator, &out, base, through));
+    try std.testing.expectEqual(square.len, out.items.len);
+    try std.testing.expectEqual(20, out.items[0].x);
+
+    // not deep enough
+    const blind: Profile = .{ .segments = &square, .length = 10, .frame = frame };
+    try std.testing.expect(!try foldCutout(allocator, &out, base, blind));
+
+    // rotated around X, so extruded sideways
+    const sideways: Profile = .{
+        .segments = &square,
+        .length = 30,
+        .frame = .{ 1, 0, 0, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 0, 0, 1 },
+    };
+    try std.testing.expect(!try foldCutout(allocator, &out, base, sideways));
+
+    // mirrored cutouts are reversed to keep their orientation
+    out.clearRetainingCapacity();
+    const mirrored: Profile = .{
+        .segments = &square,
+        .length = 30,
+        .frame = .{ -1, 0, 0, 0, 0, 1, 0, 0, 0, 0, -1, 0, 0, 0, 20, 1 },
+    };
+    try std.testing.expect(try foldCutout(allocator, &out, base, mirrored));
+    try std.testing.expectEqual('M', out.items[0].command);
+    try std.testing.expectEqual(-10, out.items[1].x);
+    try std.testing.expectEqual(0, out.items[1].y);
+    try std.testing.expectEqual(-10, out.items[2].x);
+    try std.testing.expectEqual(10, out.items[2].y);
+    try std.testing.expectEqual('Z', out.items[out.items.len - 1].command);
+}
@@ -0,0 +1,180 @@
+#include <cmath>
+#include <iostream>
+
+#include <BRepAlgoAPI_Cut.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <BRepPrimAPI_MakeCylinder.hxx>
+#include <BRepPrimAPI_MakeRevol.hxx>
+#include <BRep_Builder.hxx>
+#include <TopTools_ListOfShape.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <TopoDS_Iterator.hxx>
+#include <gp_Ax1.hxx>
+#include <gp_Trsf.hxx>
+
+#include "occ.hxx"
+#include "opaque.hxx"
+
+static gp_Trsf toTrsf(const double m[16]) {
+  gp_Trsf trsf;
+  trsf.SetValues(m[0], m[4], m[8], m[12], m[1], m[5], m[9], m[13], m[2], m[6],
+                 m[10], m[14]);
+  return trsf;
+}
+
+// compounds, as produced by patterns, are split so that every copy is a tool
+// of its own for the boolean
+static void appendTools(const TopoDS_Shape &shape, TopTools_ListOfShape &tools) {
+  if (shape.ShapeType() != TopAbs_COMPOUND) {
+    tools.Append(shape);
+    return;
+  }
+  for (TopoDS_Iterator it(shape); it.More(); it.Next())
+    appendTools(it.Value(), tools);
+}
+
+extern "C" {
+
+/**
+ * @brief Box with a corner at the origin, same as an extrusion of the
+ * `dx` by `dy` rectangle by `dz`.
+ * @return nullptr when a dimension is not strictly positive.
+ */
+Shape *makeBox(double dx, double dy, double dz) {
+  if (!(dx > 0) || !(dy > 0) || !(dz > 0)) {
+    std::cerr << "Error: invalid box dimensions." << std::endl;
+    return nullptr;
+  }
+
+  Shape *result = new Shape;
+  result->shape = BRepPrimAPI_MakeBox(dx, dy, dz).Shape();
+  return result;
+}
+
+/**
+ * @brief Cylinder around the Z axis, from z = 0 to z = `height`.
+ * @return nullptr when a dimension is not strictly positive.
+ */
+Shape *makeCylinder(double radius, double height) {
+  if (!(radius > 0) || !(height > 0)) {
+    std::cerr << "Error: invalid cylinder dimensions." << std::endl;
+    return nullptr;
+  }
+
+  Shape *result = new Shape;
+  result->shape = BRepPrimAPI_MakeCylinder(radius, height).Shape();
+  return result;
+}
+
+/**
+ * @brief Countersunk hole tool around the Z axis. The entry is at z = 0 where
+ * the countersink has `headRadius`, and the hole goes down to z = -`depth`.
+ * `angle` is the included angle of the countersink, in radians.
+ * @return nullptr when the dimensions do not describe a hole.
+ */
+Shape *makeCountersunkHole(double radius, double depth, double headRadius,
+                           double angle) {
+  if (!(radius > 0) || !(depth > 0) || !(headRadius >= radius) ||
+      !(angle > 0 && angle < M_PI)) {
+    std::cerr << "Error: invalid countersunk hole dimensions." << std::endl;
+    return nullptr;
+  }
+
+  const double slope = std::tan(angle / 2);
+  const double sinkDepth = (headRadius - radius) / slope;
+
+  // half section in the XZ plane, revolved in one go instead of fusing a cone
+  // and a cylinder
+  BRepBuilderAPI_MakePolygon polygon;
+  polygon.Add(gp_Pnt(0, 0, 0));
+  polygon.Add(gp_Pnt(headRadius, 0, 0));
+  if (sinkDepth >= depth) {
+    // the hole is shallower than the countersink, the cone is cut at its
+    // bottom and keeps its angle
+    polygon.Add(gp_Pnt(headRadius - depth * slope, 0, -depth));
+  } else {
+    if (sinkDepth > 0)
+      polygon.Add(gp_Pnt(radius, 0, -sinkDepth));
+    polygon.Add(gp_Pnt(radius, 0, -depth));
+  }
+  polygon.Add(gp_Pnt(0, 0, -depth));
+  polygon.Close();
+
+  if (!polygon.IsDone()) {
+    std::cerr << "Error: invalid countersunk hole dimensions." << std::endl;
+    return nullptr;
+  }
+
+  TopoDS_Face face = BRepBuilderAPI_MakeFace(polygon.Wire(), true);
+  gp_Ax1 axis(gp_Pnt(0, 0, 0), gp_Dir(0, 0, 1));
+
+  Shape *result = new Shape;
+  result->shape = BRepPrimAPI_MakeRevol(face, axis, 2.0 * M_PI).Shape();
+  return result;
+}
+
+/**
+ * @brief Compound of `count` copies of `shape`, each one moved by one of the
+ * column-major matrices in `transforms`, expressed in the frame the shape is
+ * located in. Copies share the geometry of the original, only their locations
+ * differ.
+ */
+Shape *patternShape(Shape *shape, const double *transforms, size_t count) {
+  if (!shape)
+    return nullptr;
+
+  BRep_Builder builder;
+  TopoDS_Compound compound;
+  builder.MakeCompound(compound);
+
+  const TopLoc_Location existing = shape->shape.Location();
+  for (size_t i = 0; i < count; i++) {
+    TopLoc_Location loc(toTrsf(transforms + 16 * i));
+    builder.Add(compound, shape->shape.Located(loc.Multiplied(existing)));
+  }
+
+  Shape *result = new Shape;
+  result->shape = compound;
+  return result;
+}
+
+/**
+ * @brief Removes all the cutouts from `toCut` in a single boolean operation.
+ */
+Shape *cutShapes(Shape *toCut, Shape *const *cutouts, size_t count) {
+  if (!toCut) {
+    std::cout << "couldn't cut shapes as the base is null" << std::endl;
+    return toCut;
+  }
+
+  TopTools_ListOfShape arguments;
+  arguments.Append(toCut->shape);
+
+  TopTools_ListOfShape tools;
+  for (size_t i = 0; i < count; i++) {
+    if (cutouts[i])
+      appendTools(cutouts[i]->shape, tools);
+  }
+  if (tools.IsEmpty())
+    return toCut;
+
+  BRepAlgoAPI_Cut cut;
+  cut.SetArguments(arguments);
+  cut.SetTools(tools);
+  // recipes are already evaluated on every core by the batch endpoints
+  cut.SetRunParallel(false);
+  cut.Build();
+
+  if (!cut.IsDone()) {
+    std::cerr << "Error: boolean cut failed." << std::endl;
+    return toCut;
+  }
+
+  Shape *result = new Shape;
+  result->shape = cut.Shape();
+  return result;
+}
+}
@@ -0,0 +1,70 @@
+#include <BRepBndLib.hxx>
+#include <BRepGProp.hxx>
+#include <Bnd_Box.hxx>
+#include <Bnd_OBB.hxx>
+#include <GProp_GProps.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS_Shape.hxx>
+
+#include "occ.hxx"
+#include "opaque.hxx"
+
+static size_t countSubShapes(const TopoDS_Shape &shape, TopAbs_ShapeEnum type) {
+  TopTools_IndexedMapOfShape map;
+  TopExp::MapShapes(shape, type, map);
+  return map.Extent();
+}
+
+static void writeXYZ(const gp_XYZ &xyz, double *out) {
+  out[0] = xyz.X();
+  out[1] = xyz.Y();
+  out[2] = xyz.Z();
+}
+
+extern "C" {
+
+/**
+ * @brief Computes bounding boxes, mass properties and topology counts of a
+ * shape straight from its B-rep, without meshing it.
+ */
+void computeShapeProperties(const Shape *shape, ShapeProperties *properties) {
+  *properties = ShapeProperties{};
+  if (!shape || shape->shape.IsNull())
+    return;
+
+  const TopoDS_Shape &s = shape->shape;
+
+  Bnd_Box box;
+  BRepBndLib::AddOptimal(s, box, false, false);
+  if (!box.IsVoid()) {
+    double *b = properties->aabb;
+    box.Get(b[0], b[1], b[2], b[3], b[4], b[5]);
+  }
+
+  Bnd_OBB obb;
+  BRepBndLib::AddOBB(s, obb, false, true, false);
+  if (!obb.IsVoid()) {
+    writeXYZ(obb.Center(), properties->obbCenter);
+    writeXYZ(obb.XDirection(), properties->obbAxes);
+    writeXYZ(obb.YDirection(), properties->obbAxes + 3);
+    writeXYZ(obb.ZDirection(), properties->obbAxes + 6);
+    properties->obbHalfSizes[0] = obb.XHSize();
+    properties->obbHalfSizes[1] = obb.YHSize();
+    properties->obbHalfSizes[2] = obb.ZHSize();
+  }
+
+  GProp_GProps volumeProps;
+  BRepGProp::VolumeProperties(s, volumeProps);
+  properties->volume = volumeProps.Mass();
+  writeXYZ(volumeProps.CentreOfMass().XYZ(), properties->centroid);
+
+  GProp_GProps surfaceProps;
+  BRepGProp::SurfaceProperties(s, surfaceProps);
+  properties->area = surfaceProps.Mass();
+
+  properties->nbSolids = countSubShapes(s, TopAbs_SOLID);
+  properties->nbFaces = countSubShapes(s, TopAbs_FACE);
+  properties->nbEdges = countSubShapes(s, TopAbs_EDGE);
+}
+}
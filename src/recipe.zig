@@ -0,0 +1,604 @@
+const std = @import("std");
+const parse = @import("parse_path.zig");
+const occ = @import("occ.zig");
+const Allocator = std.mem.Allocator;
+
+const PathSegment = occ.PathSegment;
+
+pub const Transform = [16]f64;
+
+pub const identity: Transform = .{ 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+// the values are part of the binary encoding, see lib/binary.js
+pub const Operation = enum(u8) {
+    extrusion = 0,
+    sweep = 1,
+    revolve = 2,
+    locate = 3,
+    fuse = 4,
+    intersect = 5,
+    cut = 6,
+    box = 7,
+    cylinder = 8,
+    countersink = 9,
+    linear_pattern = 10,
+    circular_pattern = 11,
+};
+
+/// A range in one of the contiguous arrays of a `Recipe`.
+pub const Span = struct {
+    start: u32 = 0,
+    len: u32 = 0,
+
+    pub fn end(self: Span) u32 {
+        return self.start + self.len;
+    }
+};
+
+pub const Operand = struct {
+    shape: u32,
+    placement: ?Transform = null,
+};
+
+pub const Step = struct {
+    operation: Operation,
+    placement: ?Transform = null,
+    length: f64 = 0,
+    axis: Transform = identity,
+    /// countersink angle, or angle between the copies of a circular pattern
+    rotation: f64 = 0,
+    /// dimensions of a box, or offset between the copies of a linear pattern
+    size: [3]f64 = .{ 0, 0, 0 },
+    /// radius of a cylinder or of a countersunk hole
+    radius: f64 = 0,
+    /// radius of the countersink at the hole entry
+    head_radius: f64 = 0,
+    /// number of copies of a pattern, including the original
+    count: u32 = 0,
+    /// index of the step a `locate`, a `cut` or a pattern applies to
+    shape: u32 = 0,
+    /// sweep directrix or revolved path, always directly followed by `profile`
+    path: Span = .{},
+    /// outsides then insides of extrusions and sweeps
+    profile: Span = .{},
+    /// shapes of a `fuse` or an `intersect`, cutouts of a `cut`
+    operands: Span = .{},
+};
+
+/// Native form of a shape recipe, paths and operands of all steps are stored
+/// contiguously and referenced by spans.
+pub const Recipe = struct {
+    steps: []Step,
+    segments: []PathSegment,
+    operands: []Operand,
+
+    pub fn pathOf(self: *const Recipe, step: Step) []PathSegment {
+        return self.segments[step.path.start..step.path.end()];
+    }
+
+    pub fn profileOf(self: *const Recipe, step: Step) []PathSegment {
+        return self.segments[step.profile.start..step.profile.end()];
+    }
+
+    pub fn operandsOf(self: *const Recipe, step: Step) []Operand {
+        return self.operands[step.operands.start..step.operands.end()];
+    }
+
+    /// Content hash of the recipe, independent of the encoding it was decoded
+    /// from.
+    pub fn hash(self: *const Recipe) u64 {
+        var hasher = std.hash.Wyhash.init(0);
+        for (self.steps) |step| {
+            hasher.update(&.{@intFromEnum(step.operation)});
+            hashTransform(&hasher, step.placement);
+            hasher.update(std.mem.asBytes(&step.length));
+            hashTransform(&hasher, step.axis);
+            hasher.update(std.mem.asBytes(&step.rotation));
+            hasher.update(std.mem.asBytes(&step.size));
+            hasher.update(std.mem.asBytes(&step.radius));
+            hasher.update(std.mem.asBytes(&step.head_radius));
+            hasher.update(std.mem.asBytes(&step.count));
+            hasher.update(std.mem.asBytes(&step.shape));
+            for (self.pathOf(step)) |seg| hashSegment(&hasher, seg);
+            hasher.update("|");
+            for (self.profileOf(step)) |seg| hashSegment(&hasher, seg);
+            hasher.update("|");
+            for (self.operandsOf(step)) |operand| {
+                hasher.update(std.mem.asBytes(&operand.shape));
+                hashTransform(&hasher, operand.placement);
+            }
+        }
+        return hasher.final();
+    }
+
+    /// Reads a recipe from its binary encoding, see `Decoder`.
+    pub fn decode(allocator: Allocator, bytes: []const u8) DecodeError!Recipe {
+        var decoder = Decoder.init(bytes);
+        return decoder.recipe(allocator);
+    }
+
+    /// Lets `std.json` decode a recipe (as posted by lib/part.js) directly
+    /// into its native form.
+    pub fn jsonParse(allocator: Allocator, source: anytype, options: std.json.ParseOptions) std.json.ParseError(@TypeOf(source.*))!Recipe {
+        const json = try std.json.innerParse(JsonRecipe, allocator, source, options);
+        return fromJson(allocator, json) catch |err| switch (err) {
+            error.OutOfMemory => error.OutOfMemory,
+            else => error.SyntaxError,
+        };
+    }
+};
+
+fn hashTransform(hasher: *std.hash.Wyhash, transform: ?Transform) void {
+    if (transform) |t| {
+        hasher.update(&.{1});
+        hasher.update(std.mem.asBytes(&t));
+    } else {
+        hasher.update(&.{0});
+    }
+}
+
+// field by field as the struct has padding
+fn hashSegment(hasher: *std.hash.Wyhash, seg: PathSegment) void {
+    hasher.update(&.{ seg.command, seg.large_arc, seg.sweep });
+    hasher.update(std.mem.asBytes(&[_]f32{ seg.x, seg.y, seg.radius, seg.radius2, seg.axis_rotation }));
+}
+
+const JsonOperand = struct {
+    shape: u32,
+    placement: ?Transform = null,
+};
+
+const JsonStep = struct {
+    type: Operation,
+    placement: ?Transform = null,
+    length: f64 = 0,
+    outsides: []const []const u8 = &.{},
+    insides: []const []const u8 = &.{},
+    directrix: []const u8 = "",
+    path: []const u8 = "",
+    axis: Transform = identity,
+    rotation: f64 = 0,
+    size: [3]f64 = .{ 0, 0, 0 },
+    offset: [3]f64 = .{ 0, 0, 0 },
+    radius: f64 = 0,
+    head_radius: f64 = 0,
+    count: u32 = 0,
+    shape: u32 = 0,
+    shapes: []const JsonOperand = &.{},
+    cutouts: []const JsonOperand = &.{},
+};
+
+const JsonRecipe = struct {
+    shape: []const JsonStep,
+};
+
+const Builder = struct {
+    allocator: Allocator,
+    steps: std.ArrayList(Step) = .empty,
+    segments: std.ArrayList(PathSegment) = .empty,
+    operands: std.ArrayList(Operand) = .empty,
+
+    fn addPath(self: *Builder, path: []const u8) !void {
+        var iterator = parse.SVGPathIterator.init(path);
+        while (try iterator.next()) |val| {
+            try self.segments.append(self.allocator, val);
+        }
+    }
+
+    fn spanFrom(start: usize, list_len: usize) Span {
+        return .{ .start = @intCast(start), .len = @intCast(list_len - start) };
+    }
+
+    /// Steps can only refer to the steps before them, anything else would
+    /// read a shape that is not built yet.
+    fn addStep(self: *Builder, step: Step) DecodeError!void {
+        const index = self.steps.items.len;
+        switch (step.operation) {
+            .locate, .cut => {
+                if (step.shape >= index) return error.InvalidShapeIndex;
+            },
+            .box => {
+                for (step.size) |size| if (!(size > 0)) return error.InvalidRecipe;
+            },
+            .cylinder => {
+                if (!(step.radius > 0) or !(step.length > 0)) return error.InvalidRecipe;
+            },
+            .linear_pattern, .circular_pattern => {
+                if (step.shape >= index) return error.InvalidShapeIndex;
+                if (step.count > max_pattern_copies) return error.InvalidRecipe;
+            },
+            else => {},
+        }
+        for (self.operands.items[step.operands.start..step.operands.end()]) |operand| {
+            if (operand.shape >= index) return error.InvalidShapeIndex;
+        }
+        self.steps.appendAssumeCapacity(step);
+    }
+
+    fn finish(self: *Builder) !Recipe {
+        return .{
+            .steps = try self.steps.toOwnedSlice(self.allocator),
+            .segments = try self.segments.toOwnedSlice(self.allocator),
+            .operands = try self.operands.toOwnedSlice(self.allocator),
+        };
+    }
+};
+
+fn fromJson(allocator: Allocator, json: JsonRecipe) !Recipe {
+    var builder: Builder = .{ .allocator = allocator };
+    try builder.steps.ensureTotalCapacity(allocator, json.shape.len);
+
+    for (json.shape) |item| {
+        var step: Step = .{
+            .operation = item.type,
+            .placement = item.placement,
+            .length = item.length,
+            .axis = item.axis,
+            .rotation = item.rotation,
+            .size = if (item.type == .linear_pattern) item.offset else item.size,
+            .radius = item.radius,
+            .head_radius = item.head_radius,
+            .count = item.count,
+            .shape = item.shape,
+        };
+
+        var start = builder.segments.items.len;
+        switch (item.type) {
+            .sweep => try builder.addPath(item.directrix),
+            .revolve => try builder.addPath(item.path),
+            else => {},
+        }
+        step.path = Builder.spanFrom(start, builder.segments.items.len);
+
+        start = builder.segments.items.len;
+        for (item.outsides) |path| try builder.addPath(path);
+        for (item.insides) |path| try builder.addPath(path);
+        step.profile = Builder.spanFrom(start, builder.segments.items.len);
+
+        start = builder.operands.items.len;
+        const operands = if (item.type == .cut) item.cutouts else item.shapes;
+        for (operands) |operand| {
+            try builder.operands.append(allocator, .{ .shape = operand.shape, .placement = operand.placement });
+        }
+        step.operands = Builder.spanFrom(start, builder.operands.items.len);
+
+        try builder.addStep(step);
+    }
+
+    return builder.finish();
+}
+
+pub const binary_content_type = "application/x-cade-recipe";
+pub const binary_version = 1;
+
+// smallest encodings, used to bound the element counts read from a body
+const min_string_size = 4;
+const min_operand_size = 5;
+/// a fuse without operands: operation, placement flag and count
+const min_step_size = 6;
+/// magic, version and step count
+pub const min_recipe_size = 9;
+/// the number of copies is not bounded by the body size, so it is capped
+pub const max_pattern_copies = 100_000;
+
+pub const DecodeError = error{
+    InvalidMagic,
+    UnsupportedVersion,
+    UnexpectedEndOfData,
+    InvalidOperation,
+    InvalidShapeIndex,
+    InvalidRecipe,
+    OutOfMemory,
+} || parse.ParseError || std.fmt.ParseFloatError;
+
+/// Reads the little endian binary encoding written by lib/binary.js:
+///
+///     recipe    := "CADR" u8:version u32:count step*
+///     step      := u8:operation u8:has_placement [transform] body
+///     extrusion := f64:length paths:outsides paths:insides
+///     sweep     := string:directrix paths:outsides paths:insides
+///     revolve   := string:path transform:axis f64:rotation
+///     locate    := u32:shape
+///     fuse      := operands
+///     intersect := operands
+///     cut       := u32:shape operands
+///     box       := f64*3:size
+///     cylinder  := f64:radius f64:length
+///     countersink := f64:radius f64:length f64:head_radius f64:rotation
+///     linear_pattern := u32:shape u32:count f64*3:size
+///     circular_pattern := u32:shape u32:count transform:axis f64:rotation
+///     operands  := u32:count (u32:shape u8:has_placement [transform])*
+///     paths     := u32:count string*
+///     string    := u32:length u8*
+///     transform := f64*16
+pub const Decoder = struct {
+    bytes: []const u8,
+    pos: usize = 0,
+
+    pub fn init(bytes: []const u8) Decoder {
+        return .{ .bytes = bytes };
+    }
+
+    fn take(self: *Decoder, len: usize) DecodeError![]const u8 {
+        if (self.bytes.len - self.pos < len) return error.UnexpectedEndOfData;
+        const result = self.bytes[self.pos..][0..len];
+        self.pos += len;
+        return result;
+    }
+
+    pub fn int(self: *Decoder, comptime T: type) DecodeError!T {
+        const raw = try self.take(@sizeOf(T));
+        return std.mem.readInt(T, raw[0..@sizeOf(T)], .little);
+    }
+
+    pub fn float(self: *Decoder) DecodeError!f64 {
+        return @bitCast(try self.int(u64));
+    }
+
+    pub fn string(self: *Decoder) DecodeError![]const u8 {
+        return self.take(try self.int(u32));
+    }
+
+    pub fn transform(self: *Decoder) DecodeError!Transform {
+        var result: Transform = undefined;
+        for (&result) |*value| value.* = try self.float();
+        return result;
+    }
+
+    fn vector(self: *Decoder) DecodeError![3]f64 {
+        return .{ try self.float(), try self.float(), try self.float() };
+    }
+
+    pub fn optionalTransform(self: *Decoder) DecodeError!?Transform {
+        if (try self.int(u8) == 0) return null;
+        return try self.transform();
+    }
+
+    /// Reads the number of elements that follow, each taking at least
+    /// `min_size` bytes, and rejects counts the remaining bytes cannot hold
+    /// before anything gets allocated for them.
+    pub fn count(self: *Decoder, min_size: usize) DecodeError!u32 {
+        const result = try self.int(u32);
+        if (result > (self.bytes.len - self.pos) / min_size) return error.InvalidRecipe;
+        return result;
+    }
+
+    pub fn header(self: *Decoder, magic: *const [4]u8) DecodeError!void {
+        if (!std.mem.eql(u8, try self.take(4), magic)) return error.InvalidMagic;
+        if (try self.int(u8) != binary_version) return error.UnsupportedVersion;
+    }
+
+    fn paths(self: *Decoder, builder: *Builder) DecodeError!void {
+        const nb_paths = try self.count(min_string_size);
+        for (0..nb_paths) |_| try builder.addPath(try self.string());
+    }
+
+    fn operands(self: *Decoder, builder: *Builder) DecodeError!Span {
+        const start = builder.operands.items.len;
+        const nb_operands = try self.count(min_operand_size);
+        for (0..nb_operands) |_| {
+            const shape = try self.int(u32);
+            const placement = try self.optionalTransform();
+            try builder.operands.append(builder.allocator, .{ .shape = shape, .placement = placement });
+        }
+        return Builder.spanFrom(start, builder.operands.items.len);
+    }
+
+    pub fn recipe(self: *Decoder, allocator: Allocator) DecodeError!Recipe {
+        try self.header("CADR");
+
+        var builder: Builder = .{ .allocator = allocator };
+        const nb_steps = try self.count(min_step_size);
+        try builder.steps.ensureTotalCapacity(allocator, nb_steps);
+
+        for (0..nb_steps) |_| {
+            const operation = std.enums.fromInt(Operation, try self.int(u8)) orelse return error.InvalidOperation;
+            var start = builder.segments.items.len;
+            var step: Step = .{
+                .operation = operation,
+                .placement = try self.optionalTransform(),
+                .path = Builder.spanFrom(start, start),
+                .profile = Builder.spanFrom(start, start),
+                .operands = Builder.spanFrom(builder.operands.items.len, builder.operands.items.len),
+            };
+
+            switch (operation) {
+                .extrusion => {
+                    step.length = try self.float();
+                    try self.paths(&builder);
+                    try self.paths(&builder);
+                    step.profile = Builder.spanFrom(start, builder.segments.items.len);
+                },
+                .sweep => {
+                    try builder.addPath(try self.string());
+                    step.path = Builder.spanFrom(start, builder.segments.items.len);
+                    start = builder.segments.items.len;
+                    try self.paths(&builder);
+                    try self.paths(&builder);
+                    step.profile = Builder.spanFrom(start, builder.segments.items.len);
+                },
+                .revolve => {
+                    try builder.addPath(try self.string());
+                    step.path = Builder.spanFrom(start, builder.segments.items.len);
+                    step.profile = .{ .start = step.path.end() };
+                    step.axis = try self.transform();
+                    step.rotation = try self.float();
+                },
+                .locate => step.shape = try self.int(u32),
+                .fuse, .intersect => step.operands = try self.operands(&builder),
+                .cut => {
+                    step.shape = try self.int(u32);
+                    step.operands = try self.operands(&builder);
+                },
+                .box => step.size = try self.vector(),
+                .cylinder => {
+                    step.radius = try self.float();
+                    step.length = try self.float();
+                },
+                .countersink => {
+                    step.radius = try self.float();
+                    step.length = try self.float();
+                    step.head_radius = try self.float();
+                    step.rotation = try self.float();
+                },
+                .linear_pattern => {
+                    step.shape = try self.int(u32);
+                    step.count = try self.int(u32);
+                    step.size = try self.vector();
+                },
+                .circular_pattern => {
+                    step.shape = try self.int(u32);
+                    step.count = try self.int(u32);
+                    step.axis = try self.transform();
+                    step.rotation = try self.float();
+                },
+            }
+
+            try builder.addStep(step);
+        }
+
+        return builder.finish();
+    }
+};
+
+test "binary and json recipes decode to the same steps" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+    const allocator = arena.allocator();
+
+    const json =
+        \\ {"shape":[
+        \\   {"type":"extrusion","placement":null,"length":15,"outsides":["M 0 0 L 10 0 L 10 10 Z"],"insides":[]},
+        \\   {"type":"locate","shape":0,"placement":[1,0,0,0,0,1,0,0,0,0,1,0,5,0,0,1]},
+        \\   {"type":"cut","shape":0,"cutouts":[{"shape":1}]}
+        \\ ],"name":"test"}
+    ;
+    const from_json = try std.json.parseFromSliceLeaky(Recipe, allocator, json, .{ .ignore_unknown_fields = true });
+
+    var bytes: std.ArrayList(u8) = .empty;
+    const path = "M 0 0 L 10 0 L 10 10 Z";
+    var translation = identity;
+    translation[12] = 5;
+
+    try bytes.appendSlice(allocator, "CADR");
+    try bytes.append(allocator, binary_version);
+    try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u32, 3)));
+
+    try bytes.appendSlice(allocator, &.{ @intFromEnum(Operation.extrusion), 0 });
+    try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u64, @bitCast(@as(f64, 15)))));
+    try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u32, 1)));
+    try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u32, path.len)));
+    try bytes.appendSlice(allocator, path);
+    try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u32, 0)));
+
+    try bytes.appendSlice(allocator, &.{ @intFromEnum(Operation.locate), 1 });
+    for (translation) |value| try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u64, @bitCast(value))));
+    try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u32, 0)));
+
+    try bytes.appendSlice(allocator, &.{ @intFromEnum(Operation.cut), 0 });
+    try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u32, 0)));
+    try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u32, 1)));
+    try bytes.appendSlice(allocator, &std.mem.toBytes(std.mem.nativeToLittle(u32, 1)));
+    try bytes.append(allocator, 0);
+
+    var decoder = Decoder.init(bytes.items);
+    const from_binary = try decoder.recipe(allocator);
+
+    try std.testing.expectEqual(from_json.steps.len, from_binary.steps.len);
+    try std.testing.expectEqual(4, from_binary.segments.len);
+    for (from_json.steps, from_binary.steps) |a, b| {
+        try std.testing.expectEqualDeep(a, b);
+    }
+    try std.testing.expectEqualDeep(from_json.operands, from_binary.operands);
+    try std.testing.expectEqual(from_json.hash(), from_binary.hash());
+}
+
+test "primitives and patterns" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+
+    const json =
+        \\ {"shape":[
+        \\   {"type":"box","size":[100,50,18]},
+        \\   {"type":"cylinder","radius":2.5,"length":18},
+        \\   {"type":"linear_pattern","shape":1,"count":32,"offset":[32,0,0]},
+        \\   {"type":"cut","shape":0,"cutouts":[{"shape":2}]}
+        \\ ]}
+    ;
+    const parsed = try std.json.parseFromSliceLeaky(Recipe, arena.allocator(), json, .{});
+
+    try std.testing.expectEqual(Operation.box, parsed.steps[0].operation);
+    try std.testing.expectEqual(18, parsed.steps[0].size[2]);
+    try std.testing.expectEqual(2.5, parsed.steps[1].radius);
+    try std.testing.expectEqual(32, parsed.steps[2].count);
+    try std.testing.expectEqual(32, parsed.steps[2].size[0]);
+    try std.testing.expectEqual(0, parsed.segments.len);
+}
+
+test "steps only refer to previous steps" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+
+    const forward =
+        \\ {"shape":[{"type":"box","size":[1,1,1]},{"type":"cut","shape":0,"cutouts":[{"shape":2}]}]}
+    ;
+    try std.testing.expectError(error.SyntaxError, std.json.parseFromSliceLeaky(Recipe, arena.allocator(), forward, .{}));
+
+    const itself =
+        \\ {"shape":[{"type":"locate","shape":0}]}
+    ;
+    try std.testing.expectError(error.SyntaxError, std.json.parseFromSliceLeaky(Recipe, arena.allocator(), itself, .{}));
+
+    var bytes: std.ArrayList(u8) = .empty;
+    try bytes.appendSlice(arena.allocator(), "CADR");
+    try bytes.append(arena.allocator(), binary_version);
+    try bytes.appendSlice(arena.allocator(), &std.mem.toBytes(std.mem.nativeToLittle(u32, 1)));
+    try bytes.appendSlice(arena.allocator(), &.{ @intFromEnum(Operation.locate), 0 });
+    try bytes.appendSlice(arena.allocator(), &std.mem.toBytes(std.mem.nativeToLittle(u32, 7)));
+    try std.testing.expectError(error.InvalidShapeIndex, Recipe.decode(arena.allocator(), bytes.items));
+}
+
+test "primitives without volume are rejected" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+
+    const flat_box =
+        \\ {"shape":[{"type":"box","size":[100,0,18]}]}
+    ;
+    try std.testing.expectError(error.SyntaxError, std.json.parseFromSliceLeaky(Recipe, arena.allocator(), flat_box, .{}));
+
+    const no_cylinder =
+        \\ {"shape":[{"type":"cylinder","radius":2.5}]}
+    ;
+    try std.testing.expectError(error.SyntaxError, std.json.parseFromSliceLeaky(Recipe, arena.allocator(), no_cylinder, .{}));
+
+    var bytes: std.ArrayList(u8) = .empty;
+    try bytes.appendSlice(arena.allocator(), "CADR");
+    try bytes.append(arena.allocator(), binary_version);
+    try bytes.appendSlice(arena.allocator(), &std.mem.toBytes(std.mem.nativeToLittle(u32, 1)));
+    try bytes.appendSlice(arena.allocator(), &.{ @intFromEnum(Operation.box), 0 });
+    for ([_]f64{ 100, 50, 0 }) |size| {
+        try bytes.appendSlice(arena.allocator(), &std.mem.toBytes(std.mem.nativeToLittle(u64, @bitCast(size))));
+    }
+    try std.testing.expectError(error.InvalidRecipe, Recipe.decode(arena.allocator(), bytes.items));
+}
+
+test "counts larger than the body are rejected" {
+    var arena = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena.deinit();
+
+    // claims four billion steps in 9 bytes
+    var bytes: std.ArrayList(u8) = .empty;
+    try bytes.appendSlice(arena.allocator(), "CADR");
+    try bytes.append(arena.allocator(), binary_version);
+    try bytes.appendSlice(arena.allocator(), &std.mem.toBytes(std.mem.nativeToLittle(u32, std.math.maxInt(u32))));
+    try std.testing.expectError(error.InvalidRecipe, Recipe.decode(arena.allocator(), bytes.items));
+
+    // a single extrusion claiming a million outsides
+    bytes.shrinkRetainingCapacity(5);
+    try bytes.appendSlice(arena.allocator(), &std.mem.toBytes(std.mem.nativeToLittle(u32, 1)));
+    try bytes.appendSlice(arena.allocator(), &.{ @intFromEnum(Operation.extrusion), 0 });
+    try bytes.appendSlice(arena.allocator(), &std.mem.toBytes(std.mem.nativeToLittle(u64, @bitCast(@as(f64, 15)))));
+    try bytes.appendSlice(arena.allocator(), &std.mem.toBytes(std.mem.nativeToLittle(u32, 1_000_000)));
+    try std.testing.expectError(error.InvalidRecipe, Recipe.decode(arena.allocator(), bytes.items));
+}
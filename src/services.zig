@@ -2,15 +2,22 @@ const std = @import("std");
 const http = std.http;
 const parse = @import("parse_path.zig");
 const api = @import("api.zig");
+const recipe = @import("recipe.zig");
 const getFileFromQueryParams = @import("utils.zig").getFileFromQueryParams;
+const tagMatches = @import("utils.zig").tagMatches;
 
 const reqBodySize = 1024 * std.math.pow(i32, 2, 8);
 const meshBodySize = 1024 * std.math.pow(i32, 2, 10);
+const batchBodySize = 1024 * std.math.pow(i32, 2, 12);
 
 const ServerAction = enum {
     export_step,
     solidify,
+    solidify_batch,
     project,
+    section,
+    query,
+    clash,
     save,
     unknown,
 };
@@ -18,7 +25,11 @@ const ServerAction = enum {
 const actions_map = std.StaticStringMap(ServerAction).initComptime(.{
     .{ "/occ/export", .export_step },
     .{ "/occ/solidify", .solidify },
+    .{ "/occ/solidify-batch", .solidify_batch },
     .{ "/occ/project", .project },
+    .{ "/occ/section", .section },
+    .{ "/occ/query", .query },
+    .{ "/occ/clash", .clash },
     .{ "/occ/save", .save },
 });
 
@@ -46,23 +57,43 @@ fn save(req: *http.Server.Request, allocator: std.mem.Allocator, io: std.Io) !vo
 }
 
 fn solidify(req: *http.Server.Request, allocator: std.mem.Allocator) !void {
+    const binary = hasBinaryBody(req);
+
+    // headers are not readable anymore once the body is
+    var tag_buf: [512]u8 = undefined;
+    const if_none_match = copyHeader(req, "if-none-match", &tag_buf);
+
     const body = readRequestBody(req, allocator, reqBodySize) catch |err| {
         try sendJsonError(req, "Failed to read request body", 400);
         return err;
     };
     defer allocator.free(body);
 
-    std.debug.print("Received body: {s}\n", .{body});
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
 
-    var input = std.json.parseFromSlice(std.json.Value, allocator, body, .{}) catch |err| {
-        std.debug.print("JSON parse error: {any}\n", .{err});
-        try sendJsonError(req, "Invalid JSON format", 400);
+    const input = decodeBody(api.Recipe, arena.allocator(), body, binary) catch |err| {
+        std.debug.print("Recipe decoding error: {any}\n", .{err});
+        try sendJsonError(req, "Invalid recipe format", 400);
         return;
     };
-    defer input.deinit();
+
+    const tag = api.meshTag(&input);
+    if (if_none_match) |header| {
+        if (tagMatches(header, &tag)) {
+            try req.respond("", .{ .status = .not_modified, .extra_headers = &.{
+                .{ .name = "etag", .value = &tag },
+            } });
+            return;
+        }
+    }
 
     var output_buffer: [meshBodySize]u8 = undefined;
-    const obj_size = try api.solidify(allocator, &input.value, &output_buffer);
+    const obj_size = api.solidify(allocator, &input, &output_buffer) catch |err| {
+        std.debug.print("Failed to mesh part: {any}\n", .{err});
+        try sendJsonError(req, "Part definition did not yield a mesh", 400);
+        return;
+    };
 
     if (obj_size == 0) {
         std.debug.print("Failed to solidify part\n", .{});
@@ -73,29 +104,57 @@ fn solidify(req: *http.Server.Request, allocator: std.mem.Allocator) !void {
     const response_body = output_buffer[0..obj_size];
     try req.respond(response_body, .{ .extra_headers = &.{
         .{ .name = "content-type", .value = "application/text" },
+        .{ .name = "etag", .value = &tag },
+    } });
+}
+
+fn solidifyBatch(req: *http.Server.Request, allocator: std.mem.Allocator) !void {
+    const binary = hasBinaryBody(req);
+    // a whole assembly, where single parts only have to fit in reqBodySize
+    const body = readRequestBody(req, allocator, batchBodySize) catch |err| {
+        try sendJsonError(req, "Failed to read request body", 400);
+        return err;
+    };
+    defer allocator.free(body);
+
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+
+    const input = decodeBody(api.MeshBatch, arena.allocator(), body, binary) catch |err| {
+        std.debug.print("Recipe decoding error: {any}\n", .{err});
+        try sendJsonError(req, "Invalid recipe format", 400);
+        return;
+    };
+
+    const changed = try api.solidifyChanged(allocator, &input);
+    defer api.freeMeshResults(allocator, changed);
+
+    const response_body = try std.json.Stringify.valueAlloc(allocator, .{ .parts = changed }, .{});
+    defer allocator.free(response_body);
+
+    try req.respond(response_body, .{ .extra_headers = &.{
+        .{ .name = "content-type", .value = "application/json" },
     } });
 }
 
 fn export_step(req: *http.Server.Request, allocator: std.mem.Allocator) !void {
+    const binary = hasBinaryBody(req);
     const body = readRequestBody(req, allocator, reqBodySize) catch |err| {
         try sendJsonError(req, "Failed to read request body", 400);
         return err;
     };
     defer allocator.free(body);
 
-    std.debug.print("Received body: {s}\n", .{body});
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
 
-    // Parse JSON into our struct
-    var input = std.json.parseFromSlice(api.CompactPartDefinition, allocator, body, .{
-        .ignore_unknown_fields = true, // Ignore extra fields
-    }) catch |err| {
-        std.debug.print("JSON parse error: {any}\n", .{err});
-        try sendJsonError(req, "Invalid JSON format", 400);
+    const input = decodeBody(api.CompactPartDefinition, arena.allocator(), body, binary) catch |err| {
+        std.debug.print("Recipe decoding error: {any}\n", .{err});
+        try sendJsonError(req, "Invalid recipe format", 400);
         return;
     };
-    defer input.deinit();
 
-    try api.exportAsSTEP(allocator, &input.value);
+    try api.exportAsSTEP(allocator, &input);
 
     try req.respond("wrote successfully", .{ .extra_headers = &.{
         .{ .name = "content-type", .value = "application/text" },
@@ -111,26 +170,24 @@ fn project(req: *http.Server.Request, allocator: std.mem.Allocator) !void {
     const decoded_path = std.Uri.percentDecodeBackwards(path_buf, req.head.target);
     const filename: ?[]const u8 = getFileFromQueryParams(decoded_path) catch null;
 
+    const binary = hasBinaryBody(req);
     const body = readRequestBody(req, allocator, reqBodySize) catch |err| {
         try sendJsonError(req, "Failed to read request body", 400);
         return err;
     };
     defer allocator.free(body);
 
-    std.debug.print("Received body: {s}\n", .{body});
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
 
-    // Parse JSON into our struct
-    var input = std.json.parseFromSlice(api.CompactPartDefinition, allocator, body, .{
-        .ignore_unknown_fields = true, // Ignore extra fields
-    }) catch |err| {
-        std.debug.print("JSON parse error: {any}\n", .{err});
-        try sendJsonError(req, "Invalid JSON format", 400);
+    const input = decodeBody(api.CompactPartDefinition, arena.allocator(), body, binary) catch |err| {
+        std.debug.print("Recipe decoding error: {any}\n", .{err});
+        try sendJsonError(req, "Invalid recipe format", 400);
         return;
     };
-    defer input.deinit();
 
     if (filename) |f| {
-        try api.projectSVG(allocator, &input.value, f);
+        try api.projectSVG(allocator, &input, f);
 
         try req.respond("wrote successfully", .{ .extra_headers = &.{
             .{ .name = "content-type", .value = "application/text" },
@@ -147,18 +204,109 @@ fn project(req: *http.Server.Request, allocator: std.mem.Allocator) !void {
         },
     });
 
-    try api.projectSVGInMemory(allocator, &input.value, &bodyWriter.writer);
+    try api.projectSVGInMemory(allocator, &input, &bodyWriter.writer);
     try bodyWriter.flush();
     try bodyWriter.end();
 }
 
+fn section(req: *http.Server.Request, allocator: std.mem.Allocator) !void {
+    const binary = hasBinaryBody(req);
+    const body = readRequestBody(req, allocator, reqBodySize) catch |err| {
+        try sendJsonError(req, "Failed to read request body", 400);
+        return err;
+    };
+    defer allocator.free(body);
+
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+
+    const input = decodeBody(api.SectionDefinition, arena.allocator(), body, binary) catch |err| {
+        std.debug.print("Recipe decoding error: {any}\n", .{err});
+        try sendJsonError(req, "Invalid recipe format", 400);
+        return;
+    };
+
+    var buf: [1e5]u8 = undefined;
+    var bodyWriter = try req.respondStreaming(&buf, .{
+        .respond_options = .{
+            .extra_headers = &.{
+                .{ .name = "content-type", .value = "image/svg+xml" },
+            },
+        },
+    });
+
+    try api.sectionSVGInMemory(allocator, &input, &bodyWriter.writer);
+    try bodyWriter.flush();
+    try bodyWriter.end();
+}
+
+fn query(req: *http.Server.Request, allocator: std.mem.Allocator) !void {
+    const binary = hasBinaryBody(req);
+    const body = readRequestBody(req, allocator, reqBodySize) catch |err| {
+        try sendJsonError(req, "Failed to read request body", 400);
+        return err;
+    };
+    defer allocator.free(body);
+
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+
+    const input = decodeBody(api.QueryDefinition, arena.allocator(), body, binary) catch |err| {
+        std.debug.print("Recipe decoding error: {any}\n", .{err});
+        try sendJsonError(req, "Invalid recipe format", 400);
+        return;
+    };
+
+    const properties = try api.queryParts(allocator, &input);
+    defer allocator.free(properties);
+
+    const response_body = try std.json.Stringify.valueAlloc(allocator, .{ .parts = properties }, .{});
+    defer allocator.free(response_body);
+
+    try req.respond(response_body, .{ .extra_headers = &.{
+        .{ .name = "content-type", .value = "application/json" },
+    } });
+}
+
+fn clash(req: *http.Server.Request, allocator: std.mem.Allocator) !void {
+    const binary = hasBinaryBody(req);
+    const body = readRequestBody(req, allocator, reqBodySize) catch |err| {
+        try sendJsonError(req, "Failed to read request body", 400);
+        return err;
+    };
+    defer allocator.free(body);
+
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+
+    const input = decodeBody(api.CompactPartDefinition, arena.allocator(), body, binary) catch |err| {
+        std.debug.print("Recipe decoding error: {any}\n", .{err});
+        try sendJsonError(req, "Invalid recipe format", 400);
+        return;
+    };
+
+    const report = try api.findClashes(allocator, &input);
+    defer allocator.free(report.clashes);
+
+    const response_body = try std.json.Stringify.valueAlloc(allocator, report, .{});
+    defer allocator.free(response_body);
+
+    try req.respond(response_body, .{ .extra_headers = &.{
+        .{ .name = "content-type", .value = "application/json" },
+    } });
+}
+
 pub fn handlePostRequest(req: *http.Server.Request, allocator: std.mem.Allocator, io: std.Io, path: []const u8) !void {
     const action = actions_map.get(path) orelse .unknown;
 
     switch (action) {
         .export_step => try export_step(req, allocator),
         .project => try project(req, allocator),
+        .section => try section(req, allocator),
+        .query => try query(req, allocator),
         .solidify => try solidify(req, allocator),
+        .solidify_batch => try solidifyBatch(req, allocator),
+        .clash => try clash(req, allocator),
         .save => try save(req, allocator, io),
         .unknown => {
             std.debug.print("Failed to understand request: {s}\n", .{path});
@@ -168,6 +316,29 @@ pub fn handlePostRequest(req: *http.Server.Request, allocator: std.mem.Allocator
     }
 }
 
+fn copyHeader(req: *std.http.Server.Request, name: []const u8, buffer: []u8) ?[]const u8 {
+    var headers = req.iterateHeaders();
+    while (headers.next()) |header| {
+        if (!std.ascii.eqlIgnoreCase(header.name, name)) continue;
+        if (header.value.len > buffer.len) return null;
+        @memcpy(buffer[0..header.value.len], header.value);
+        return buffer[0..header.value.len];
+    }
+    return null;
+}
+
+fn hasBinaryBody(req: *std.http.Server.Request) bool {
+    const content_type = req.head.content_type orelse return false;
+    return std.mem.eql(u8, content_type, recipe.binary_content_type);
+}
+
+/// Decodes a recipe or a definition posted either as JSON or with the binary
+/// encoding of lib/binary.js, everything is allocated in `arena`.
+fn decodeBody(comptime T: type, arena: std.mem.Allocator, body: []const u8, binary: bool) !T {
+    if (binary) return T.decode(arena, body);
+    return std.json.parseFromSliceLeaky(T, arena, body, .{ .ignore_unknown_fields = true });
+}
+
 fn readRequestBody(req: *std.http.Server.Request, allocator: std.mem.Allocator, max_size: usize) ![]u8 {
 
     // Check Content-Length header
@@ -6,7 +6,9 @@
 #include <HLRBRep_Algo.hxx>
 #include <HLRBRep_HLRToShape.hxx>
 
+#include <BRepAlgoAPI_Section.hxx>
 #include <gp_Dir.hxx>
+#include <gp_Pln.hxx>
 #include <gp_Pnt2d.hxx>
 
 #include <BRepAdaptor_Curve.hxx>
@@ -14,66 +16,81 @@
 
 #include <GCPnts_QuasiUniformDeflection.hxx>
 
+#include <cmath>
+#include <iostream>
+
 #include "occ.hxx"
 #include "opaque.hxx"
 
-extern "C" {
-
-size_t shapeToSVGSegments(const Compound *compound, PathSegment *segments,
-                          size_t maxLength) {
-  Handle(HLRBRep_Algo) hlr = new HLRBRep_Algo();
-  hlr->Add(compound->compound);
-
-  auto projector = new HLRAlgo_Projector(gp_Ax2(gp_Pnt(), gp_Dir(0.7, 1, 0.3)));
-  hlr->Projector(*projector);
-  hlr->Update();
-  hlr->Hide();
-
-  HLRBRep_HLRToShape hlrToShape(hlr);
-
-  TopoDS_Shape visibleEdges = hlrToShape.VCompound();
-
+/**
+ * @brief Converts the edges of a shape lying in the XY plane to SVG path
+ * segments, the Y axis is flipped to match the SVG orientation.
+ * @return The number of segments of the edges, only the first maxLength are
+ * written so the output is truncated when this is larger than maxLength.
+ */
+size_t edgesToSegments(const TopoDS_Shape &edges, PathSegment *segments,
+                       size_t maxLength) {
   size_t writeLoc = 0;
+  bool hasLastPoint = false;
   gp_Pnt lastPoint;
-  gp_Pnt p2;
 
-  for (TopExp_Explorer ex(visibleEdges, TopAbs_EDGE); ex.More(); ex.Next()) {
+  auto push = [&](const PathSegment &segment) {
+    if (writeLoc < maxLength)
+      segments[writeLoc] = segment;
+    writeLoc++;
+  };
+
+  for (TopExp_Explorer ex(edges, TopAbs_EDGE); ex.More(); ex.Next()) {
     const TopoDS_Edge &edge = TopoDS::Edge(ex.Current());
 
     BRepAdaptor_Curve curve(edge);
     GeomAbs_CurveType type = curve.GetType();
 
-    lastPoint = p2;
-
-    gp_Pnt p1 = curve.Value(curve.FirstParameter());
-    p2 = curve.Value(curve.LastParameter());
+    const double first = curve.FirstParameter();
+    const double last = curve.LastParameter();
+    gp_Pnt p1 = curve.Value(first);
+    gp_Pnt p2 = curve.Value(last);
 
-    if (!p1.IsEqual(lastPoint, 1e-6)) {
-      PathSegment move;
+    if (!hasLastPoint || !p1.IsEqual(lastPoint, 1e-6)) {
+      PathSegment move{};
       move.x = p1.X();
       move.y = -p1.Y();
       move.command = 'M';
-      segments[writeLoc++] = move;
+      push(move);
     }
 
+    lastPoint = p2;
+    hasLastPoint = true;
+
     if (type == GeomAbs_Line) {
-      PathSegment line;
+      PathSegment line{};
       line.x = p2.X();
       line.y = -p2.Y();
       line.command = 'L';
-      segments[writeLoc++] = line;
+      push(line);
       continue;
     }
 
     if (type == GeomAbs_Circle) {
-      double r = curve.Circle().Radius();
+      auto circle = curve.Circle();
+
+      PathSegment arc{};
+      arc.command = 'A';
+      arc.radius = circle.Radius();
+      arc.large_arc = '0';
+      arc.sweep = circle.Axis().Direction().Z() > 0 ? '0' : '1';
+
+      // split big arcs, this also handles full circles
+      if (last - first > M_PI) {
+        gp_Pnt mid = curve.Value((first + last) / 2);
+        arc.x = mid.X();
+        arc.y = -mid.Y();
+        push(arc);
+      }
 
-      PathSegment arc;
       arc.x = p2.X();
       arc.y = -p2.Y();
-      arc.command = 'A';
-      arc.radius = r;
-      segments[writeLoc++] = arc;
+      push(arc);
       continue;
     }
 
@@ -87,9 +104,7 @@ size_t shapeToSVGSegments(const Compound *compound, PathSegment *segments,
       auto rot = ellipse.Axis().Direction();
       auto angle = dir.AngleWithRef(gp_Dir(1, 0, 0), rot);
 
-      PathSegment arc;
-      arc.x = p2.X();
-      arc.y = -p2.Y();
+      PathSegment arc{};
       arc.command = 'A';
       arc.radius = r2;
       arc.radius2 = r;
@@ -97,11 +112,89 @@ size_t shapeToSVGSegments(const Compound *compound, PathSegment *segments,
       arc.axis_rotation = rot.Z() * (90 + 180 * angle / 3.14159265358979323846);
 
       arc.sweep = rot.Z() > 0 ? '0' : '1';
-      segments[writeLoc++] = arc;
 
+      // same as circles, a full ellipse would start and end on the same point
+      if (last - first > M_PI) {
+        gp_Pnt mid = curve.Value((first + last) / 2);
+        arc.x = mid.X();
+        arc.y = -mid.Y();
+        push(arc);
+      }
+
+      arc.x = p2.X();
+      arc.y = -p2.Y();
+      push(arc);
+
+      continue;
+    }
+
+    // other curves are approximated by lines
+    GCPnts_QuasiUniformDeflection discretizer(curve, 0.01);
+    if (!discretizer.IsDone())
       continue;
+
+    for (int i = 2; i <= discretizer.NbPoints(); ++i) {
+      gp_Pnt p = discretizer.Value(i);
+      PathSegment line{};
+      line.x = p.X();
+      line.y = -p.Y();
+      line.command = 'L';
+      push(line);
     }
   }
+
+  if (writeLoc > maxLength)
+    std::cerr << "Warning: " << writeLoc
+              << " segments needed, svg output is truncated to " << maxLength
+              << std::endl;
+
   return writeLoc;
 }
+
+extern "C" {
+
+size_t shapeToSVGSegments(const Compound *compound, PathSegment *segments,
+                          size_t maxLength) {
+  Handle(HLRBRep_Algo) hlr = new HLRBRep_Algo();
+  hlr->Add(compound->compound);
+
+  auto projector = new HLRAlgo_Projector(gp_Ax2(gp_Pnt(), gp_Dir(0.7, 1, 0.3)));
+  hlr->Projector(*projector);
+  hlr->Update();
+  hlr->Hide();
+
+  HLRBRep_HLRToShape hlrToShape(hlr);
+
+  TopoDS_Shape visibleEdges = hlrToShape.VCompound();
+
+  return edgesToSegments(visibleEdges, segments, maxLength);
+}
+
+/**
+ * @brief Cuts the shape with the XY plane of the given transform and writes
+ * the section curves, expressed in that plane, as SVG path segments.
+ * @return The number of segments of the section, see edgesToSegments, 0 when
+ * it could not be computed.
+ */
+size_t sectionToSVGSegments(const Shape *shape, const Transform *plane,
+                            PathSegment *segments, size_t maxLength) {
+  if (!shape || !plane)
+    return 0;
+
+  // bring the shape in the plane coordinates so that the section is in XY
+  TopoDS_Shape local =
+      shape->shape.Moved(TopLoc_Location(plane->trsf.Inverted()));
+
+  BRepAlgoAPI_Section section(local, gp_Pln(gp::XOY()), Standard_False);
+  section.SetRunParallel(false);
+  section.Approximation(Standard_True);
+  section.Build();
+
+  if (!section.IsDone()) {
+    std::cerr << "Error: could not compute section" << std::endl;
+    return 0;
+  }
+
+  return edgesToSegments(section.Shape(), segments, maxLength);
+}
 }
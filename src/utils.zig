@@ -19,6 +19,27 @@ pub fn getFileFromQueryParams(path: []const u8) ![]const u8 {
     return error.URLQueryParamNotFoundError;
 }
 
+/// Whether an If-None-Match header value lists the given entity tag. `*` is
+/// not honoured: meshes are computed from the posted recipe, a client saying
+/// it has any version of them still needs the one matching that recipe.
+pub fn tagMatches(header: []const u8, tag: []const u8) bool {
+    var it = std.mem.splitScalar(u8, header, ',');
+    while (it.next()) |item| {
+        var candidate = std.mem.trim(u8, item, " \t");
+        if (std.mem.startsWith(u8, candidate, "W/")) candidate = candidate[2..];
+        if (std.mem.eql(u8, candidate, tag)) return true;
+    }
+    return false;
+}
+
+test tagMatches {
+    try expect(tagMatches("\"abc\"", "\"abc\""));
+    try expect(tagMatches("\"xyz\", W/\"abc\"", "\"abc\""));
+    try expect(!tagMatches("*", "\"abc\""));
+    try expect(!tagMatches("\"abcd\"", "\"abc\""));
+    try expect(!tagMatches("", "\"abc\""));
+}
+
 test getFileFromQueryParams {
     var path_buf: [std.fs.max_path_bytes]u8 = undefined;
     try expectError(error.URLQueryParamNotFoundError, getFileFromQueryParams(path_buf[0..], "/hello"));